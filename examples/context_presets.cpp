@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+// Measures each context preset on the local host: one-way throughput of
+// PUSH/PULL and round-trip latency of REQ/REP, both over TCP loopback.
+//
+// usage: context_presets [message size] [message count] [roundtrip count]
+
+using bench_clock = std::chrono::steady_clock;
+
+double Throughput(zmq::context_t &ctx,
+                  const zmq::socket_options &options,
+                  size_t size,
+                  int count)
+{
+    zmq::socket_t pull(ctx, zmq::socket_type::pull);
+    options.apply(pull);
+    pull.bind("tcp://127.0.0.1:*");
+    const std::string endpoint = pull.get(zmq::sockopt::last_endpoint);
+
+    std::thread sender([&ctx, &options, &endpoint, size, count] {
+        zmq::socket_t push(ctx, zmq::socket_type::push);
+        options.apply(push);
+        push.set(zmq::sockopt::linger, -1); // deliver everything
+        push.connect(endpoint);
+        const std::vector<char> payload(size, 'x');
+        for (int i = 0; i < count; ++i)
+            push.send(zmq::buffer(payload));
+    });
+
+    zmq::message_t msg;
+    (void) pull.recv(msg);
+    const auto start = bench_clock::now();
+    for (int i = 1; i < count; ++i)
+        (void) pull.recv(msg);
+    const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    sender.join();
+    return (count - 1) / elapsed.count();
+}
+
+double Latency(zmq::context_t &ctx,
+               const zmq::socket_options &options,
+               size_t size,
+               int count)
+{
+    zmq::socket_t rep(ctx, zmq::socket_type::rep);
+    options.apply(rep);
+    rep.bind("tcp://127.0.0.1:*");
+    const std::string endpoint = rep.get(zmq::sockopt::last_endpoint);
+
+    std::thread echo([&rep, count] {
+        zmq::message_t msg;
+        for (int i = 0; i < count; ++i) {
+            (void) rep.recv(msg);
+            rep.send(msg, zmq::send_flags::none);
+        }
+    });
+
+    zmq::socket_t req(ctx, zmq::socket_type::req);
+    options.apply(req);
+    req.connect(endpoint);
+    const std::vector<char> payload(size, 'x');
+    zmq::message_t reply;
+    const auto start = bench_clock::now();
+    for (int i = 0; i < count; ++i) {
+        req.send(zmq::buffer(payload));
+        (void) req.recv(reply);
+    }
+    const std::chrono::duration<double, std::micro> elapsed =
+      bench_clock::now() - start;
+    echo.join();
+    return elapsed.count() / count;
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const int count = argc > 2 ? std::atoi(argv[2]) : 1000000;
+    const int roundtrips = argc > 3 ? std::atoi(argv[3]) : 10000;
+
+    const struct
+    {
+        const char *name;
+        zmq::context_preset preset;
+    } presets[] = {{"low_latency", zmq::context_preset::low_latency},
+                   {"high_throughput", zmq::context_preset::high_throughput},
+                   {"many_connections", zmq::context_preset::many_connections}};
+
+    std::cout << size << " byte messages, " << count << " messages, "
+              << roundtrips << " roundtrips" << std::endl;
+    for (const auto &p : presets) {
+        zmq::context_t ctx = zmq::make_context(p.preset);
+        const zmq::socket_options options = zmq::make_socket_options(p.preset);
+        const double rate = Throughput(ctx, options, size, count);
+        const double latency = Latency(ctx, options, size, roundtrips);
+        std::cout << p.name << ": io_threads=" << ctx.get(zmq::ctxopt::io_threads)
+                  << " throughput=" << static_cast<long>(rate) << " msg/s"
+                  << " latency=" << latency << " us" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+// Measures request throughput and round-trip latency through a
+// zmq::lb_broker for 1 to 64 echo workers. A single client keeps a window
+// of requests in flight, each worker accepts a fixed number of requests at
+// once.
+//
+// usage: lb_broker_benchmark [requests] [credits per worker] [window]
+
+using bench_clock = std::chrono::steady_clock;
+
+struct Config
+{
+    int requests;
+    uint32_t credits;
+    int window;
+};
+
+struct Result
+{
+    double rate;
+    double latency_us;
+};
+
+void Worker(zmq::context_t &ctx, uint32_t credits)
+{
+    zmq::socket_t worker(ctx, zmq::socket_type::dealer);
+    worker.connect("inproc://bench-lb-backend");
+    worker.send(zmq::const_buffer(nullptr, 0), zmq::send_flags::sndmore);
+    worker.send(zmq::lb_broker::credit_frame(credits), zmq::send_flags::none);
+
+    std::vector<zmq::message_t> parts;
+    try {
+        for (;;) {
+            parts.clear();
+            (void) zmq::recv_multipart(worker, std::back_inserter(parts));
+            zmq::send_multipart(worker, parts);
+        }
+    }
+    catch (const zmq::error_t &) {
+        // context shut down
+    }
+}
+
+void Request(zmq::socket_t &client)
+{
+    const int64_t sent = bench_clock::now().time_since_epoch().count();
+    client.send(zmq::const_buffer(nullptr, 0), zmq::send_flags::sndmore);
+    client.send(zmq::buffer(&sent, sizeof(sent)));
+}
+
+Result Run(const Config &cfg, int workers)
+{
+    zmq::context_t ctx(0);
+    zmq::socket_t frontend(ctx, zmq::socket_type::router);
+    zmq::socket_t backend(ctx, zmq::socket_type::router);
+    frontend.bind("inproc://bench-lb-frontend");
+    backend.bind("inproc://bench-lb-backend");
+    std::thread broker_thread([&frontend, &backend] {
+        zmq::lb_broker broker(frontend, backend);
+        try {
+            for (;;)
+                broker.poll();
+        }
+        catch (const zmq::error_t &) {
+            // context shut down
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w)
+        threads.emplace_back(Worker, std::ref(ctx), cfg.credits);
+
+    zmq::socket_t client(ctx, zmq::socket_type::dealer);
+    client.connect("inproc://bench-lb-frontend");
+
+    const auto start = bench_clock::now();
+    int sent = 0;
+    for (; sent < cfg.window && sent < cfg.requests; ++sent)
+        Request(client);
+
+    double latency_sum = 0;
+    zmq::message_t delimiter, body;
+    for (int received = 0; received < cfg.requests; ++received) {
+        (void) client.recv(delimiter);
+        (void) client.recv(body);
+        const auto now = bench_clock::now().time_since_epoch().count();
+        const bench_clock::duration latency(now - *body.data<int64_t>());
+        latency_sum += std::chrono::duration<double, std::micro>(latency).count();
+        if (sent < cfg.requests) {
+            Request(client);
+            ++sent;
+        }
+    }
+    const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+
+    client.close();
+    ctx.shutdown();
+    broker_thread.join();
+    for (auto &thread : threads)
+        thread.join();
+    return {cfg.requests / elapsed.count(), latency_sum / cfg.requests};
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg;
+    cfg.requests = argc > 1 ? std::atoi(argv[1]) : 100000;
+    cfg.credits = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 4;
+    cfg.window = argc > 3 ? std::atoi(argv[3]) : 256;
+
+    std::cout << cfg.requests << " requests, " << cfg.credits
+              << " credits per worker, " << cfg.window << " in flight"
+              << std::endl;
+    for (int workers = 1; workers <= 64; workers *= 2) {
+        const Result result = Run(cfg, workers);
+        std::cout << workers << " workers: " << static_cast<long>(result.rate)
+                  << " req/s, " << result.latency_us << " us mean latency"
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+// Compares two ways of fanning several publishing threads into one
+// subscriber stream: the XSUB/XPUB proxy topology of
+// pubsub_multithread_inproc.cpp, with one PUB socket per thread, and a
+// zmq::publisher_hub owning a single PUB socket.
+//
+// usage: publisher_hub_benchmark [threads] [messages per thread] [payload size]
+
+using bench_clock = std::chrono::steady_clock;
+
+struct Config
+{
+    int threads;
+    int messages;
+    size_t size;
+};
+
+// Receives every message and returns the rate from the first to the last.
+double Receive(zmq::socket_t &subscriber, long total)
+{
+    std::vector<zmq::message_t> parts;
+    (void) zmq::recv_multipart(subscriber, std::back_inserter(parts));
+    const auto start = bench_clock::now();
+    for (long i = 1; i < total; ++i) {
+        parts.clear();
+        (void) zmq::recv_multipart(subscriber, std::back_inserter(parts));
+    }
+    const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    return (total - 1) / elapsed.count();
+}
+
+double ProxyTopology(const Config &cfg)
+{
+    zmq::context_t ctx(0);
+    zmq::socket_t frontend(ctx, zmq::socket_type::xsub);
+    zmq::socket_t backend(ctx, zmq::socket_type::xpub);
+    frontend.set(zmq::sockopt::rcvhwm, 0);
+    backend.set(zmq::sockopt::sndhwm, 0);
+    frontend.bind("inproc://bench-proxy-in");
+    backend.bind("inproc://bench-proxy-out");
+    std::thread proxy([&frontend, &backend] {
+        try {
+            zmq::proxy(frontend, backend);
+        }
+        catch (const zmq::error_t &) {
+            // context shut down
+        }
+    });
+
+    zmq::socket_t subscriber(ctx, zmq::socket_type::sub);
+    subscriber.set(zmq::sockopt::rcvhwm, 0);
+    subscriber.set(zmq::sockopt::subscribe, "");
+    subscriber.connect("inproc://bench-proxy-out");
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < cfg.threads; ++t) {
+        workers.emplace_back([&ctx, &cfg] {
+            zmq::socket_t publisher(ctx, zmq::socket_type::pub);
+            publisher.set(zmq::sockopt::sndhwm, 0);
+            publisher.connect("inproc://bench-proxy-in");
+            // let the subscription travel through the proxy
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            const std::vector<char> payload(cfg.size, 'x');
+            for (int i = 0; i < cfg.messages; ++i) {
+                publisher.send(zmq::str_buffer("topic"), zmq::send_flags::sndmore);
+                publisher.send(zmq::buffer(payload));
+            }
+        });
+    }
+
+    const double rate =
+      Receive(subscriber, static_cast<long>(cfg.threads) * cfg.messages);
+    for (auto &worker : workers)
+        worker.join();
+    ctx.shutdown();
+    proxy.join();
+    return rate;
+}
+
+double PublisherHub(const Config &cfg)
+{
+    zmq::context_t ctx(0);
+    zmq::socket_t publisher(ctx, zmq::socket_type::pub);
+    publisher.set(zmq::sockopt::sndhwm, 0);
+    publisher.bind("inproc://bench-hub");
+
+    zmq::socket_t subscriber(ctx, zmq::socket_type::sub);
+    subscriber.set(zmq::sockopt::rcvhwm, 0);
+    subscriber.set(zmq::sockopt::subscribe, "");
+    subscriber.connect("inproc://bench-hub");
+
+    const long total = static_cast<long>(cfg.threads) * cfg.messages;
+    zmq::publisher_hub hub(std::move(publisher), 4096,
+                           static_cast<size_t>(cfg.threads));
+    std::thread owner([&hub, total] {
+        while (hub.sent() < static_cast<size_t>(total)) {
+            hub.wait(std::chrono::milliseconds(1));
+            hub.flush();
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < cfg.threads; ++t) {
+        workers.emplace_back([&hub, &cfg] {
+            auto &producer = hub.make_producer();
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            const std::vector<char> payload(cfg.size, 'x');
+            for (int i = 0; i < cfg.messages; ++i) {
+                while (!producer.try_publish(zmq::str_buffer("topic"),
+                                             zmq::buffer(payload)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    const double rate = Receive(subscriber, total);
+    for (auto &worker : workers)
+        worker.join();
+    owner.join();
+    return rate;
+}
+
+int main(int argc, char *argv[])
+{
+    Config cfg;
+    cfg.threads = argc > 1 ? std::atoi(argv[1]) : 4;
+    cfg.messages = argc > 2 ? std::atoi(argv[2]) : 100000;
+    cfg.size = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 32;
+
+    std::cout << cfg.threads << " threads, " << cfg.messages
+              << " messages each, " << cfg.size << " byte payload" << std::endl;
+    std::cout << "proxy topology: " << static_cast<long>(ProxyTopology(cfg))
+              << " msg/s" << std::endl;
+    std::cout << "publisher_hub:  " << static_cast<long>(PublisherHub(cfg))
+              << " msg/s" << std::endl;
+    return 0;
+}
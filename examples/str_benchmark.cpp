@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "zmq.hpp"
+
+// Compares the debug dump of message_t::str, writing into a reused
+// std::string or a fixed buffer, with the iostream based formatting it
+// replaced.
+//
+// usage: str_benchmark [iterations] [payload size]
+
+using bench_clock = std::chrono::steady_clock;
+
+// The former implementation of message_t::str.
+std::string StreamDump(const zmq::message_t &msg, size_t max_size = 1000)
+{
+    std::stringstream os;
+    const unsigned char *msg_data = msg.data<unsigned char>();
+    size_t size_to_print = std::min(msg.size(), max_size);
+    int is_ascii[2] = {0, 0};
+    if (size_to_print > 0)
+        is_ascii[0] = (*msg_data >= 32 && *msg_data < 127);
+
+    os << "zmq::message_t [size " << std::dec << std::setw(3) << std::setfill('0')
+       << msg.size() << "] (";
+    while (size_to_print--) {
+        const unsigned char byte = *msg_data++;
+        is_ascii[1] = (byte >= 32 && byte < 127);
+        if (is_ascii[1] != is_ascii[0])
+            os << " ";
+        if (is_ascii[1]) {
+            os << byte;
+        } else {
+            os << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+               << static_cast<short>(byte);
+        }
+        is_ascii[0] = is_ascii[1];
+    }
+    if (max_size < msg.size())
+        os << "... too big to print)";
+    else
+        os << ")";
+    return os.str();
+}
+
+template<class Dump> double NanosPerDump(int iterations, Dump dump)
+{
+    size_t total = 0;
+    const auto start = bench_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        total += dump();
+    const std::chrono::duration<double, std::nano> elapsed =
+      bench_clock::now() - start;
+    if (total == 0)
+        std::cout << "empty dumps" << std::endl;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const size_t size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+
+    // a mix of text and binary, as in a typical envelope
+    std::string payload(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        payload[i] = (i / 16) % 2 ? static_cast<char>('a' + i % 26)
+                                  : static_cast<char>(i);
+    const zmq::message_t msg(payload.data(), payload.size());
+
+    const double stream =
+      NanosPerDump(iterations, [&msg] { return StreamDump(msg).size(); });
+    std::string out;
+    const double string = NanosPerDump(iterations, [&msg, &out] {
+        msg.str(out);
+        return out.size();
+    });
+    char buf[4096];
+    const double buffer = NanosPerDump(
+      iterations, [&msg, &buf] { return msg.str(buf, sizeof(buf)); });
+
+    std::cout << size << " byte message, " << iterations << " dumps" << std::endl;
+    std::cout << "stringstream:       " << stream << " ns" << std::endl;
+    std::cout << "str(std::string &): " << string << " ns, " << stream / string
+              << "x faster" << std::endl;
+    std::cout << "str(char *, size):  " << buffer << " ns, " << stream / buffer
+              << "x faster" << std::endl;
+    return StreamDump(msg) == msg.str() ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "zmq.hpp"
+
+// Compares the header-only Z85 codec, writing into caller provided
+// buffers, with the libzmq based z85_encode/z85_decode overloads that
+// allocate a std::string or std::vector per call.
+//
+// usage: z85_benchmark [iterations] [payload size]
+
+using bench_clock = std::chrono::steady_clock;
+
+template<class Codec>
+double MegabytesPerSecond(int iterations, size_t size, Codec codec)
+{
+    size_t total = 0;
+    const auto start = bench_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        total += codec();
+    const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    if (total == 0)
+        std::cout << "empty output" << std::endl;
+    return static_cast<double>(size) * iterations / elapsed.count() / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    // Z85 without padding works on groups of four bytes
+    const size_t size =
+      (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1 << 20) / 4 * 4;
+
+    std::vector<uint8_t> data(size);
+    uint32_t state = 2463534242u;
+    for (auto &byte : data) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        byte = static_cast<uint8_t>(state);
+    }
+    const std::string encoded = zmq::z85_encode(data);
+
+    const double libzmq_encode = MegabytesPerSecond(
+      iterations, size, [&data] { return zmq::z85_encode(data).size(); });
+    std::string text(zmq::z85_encoded_size(size), '\0');
+    const double encode = MegabytesPerSecond(iterations, size, [&data, &text] {
+        return zmq::z85_encode(zmq::buffer(text), zmq::buffer(data));
+    });
+
+    const double libzmq_decode = MegabytesPerSecond(
+      iterations, size, [&encoded] { return zmq::z85_decode(encoded).size(); });
+    std::vector<uint8_t> bytes(size);
+    const double decode =
+      MegabytesPerSecond(iterations, size, [&encoded, &bytes] {
+          return zmq::z85_decode(zmq::buffer(bytes), zmq::buffer(encoded));
+      });
+
+    std::cout << size << " bytes, " << iterations << " iterations" << std::endl;
+    std::cout << "encode libzmq:  " << libzmq_encode << " MB/s" << std::endl;
+    std::cout << "encode buffers: " << encode << " MB/s, "
+              << encode / libzmq_encode << "x faster" << std::endl;
+    std::cout << "decode libzmq:  " << libzmq_decode << " MB/s" << std::endl;
+    std::cout << "decode buffers: " << decode << " MB/s, "
+              << decode / libzmq_decode << "x faster" << std::endl;
+    return text == encoded && bytes == data ? 0 : 1;
+}
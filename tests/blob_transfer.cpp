@@ -0,0 +1,198 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::blob_receiver>::value,
+              "blob_receiver should not be copy-constructible");
+
+namespace
+{
+std::vector<char> make_blob(size_t size, char seed)
+{
+    std::vector<char> blob(size);
+    for (size_t i = 0; i < size; ++i)
+        blob[i] = static_cast<char>(seed + i * 7);
+    return blob;
+}
+
+struct transfer_fixture
+{
+    transfer_fixture() : router(context, zmq::socket_type::router)
+    {
+        router.set(zmq::sockopt::rcvtimeo, 5000);
+        router.bind("inproc://blob_transfer");
+    }
+
+    zmq::socket_t make_dealer()
+    {
+        zmq::socket_t dealer(context, zmq::socket_type::dealer);
+        dealer.set(zmq::sockopt::rcvtimeo, 5000);
+        dealer.connect("inproc://blob_transfer");
+        return dealer;
+    }
+
+    zmq::context_t context;
+    zmq::socket_t router;
+};
+}
+
+TEST_CASE("blob_sender rejects invalid parameters", "[blob_transfer]")
+{
+    zmq::context_t context;
+    zmq::socket_t dealer(context, zmq::socket_type::dealer);
+    CHECK_THROWS_AS(zmq::blob_sender(dealer, 0), std::invalid_argument);
+    CHECK_THROWS_AS(zmq::blob_sender(dealer, 1024, 0), std::invalid_argument);
+}
+
+TEST_CASE("blob transfer reassembles chunks", "[blob_transfer]")
+{
+    transfer_fixture f;
+    zmq::socket_t dealer = f.make_dealer();
+    const auto blob = make_blob(100 * 1000 + 17, 'a');
+
+    std::thread sender_thread([&dealer, &blob] {
+        zmq::blob_sender sender(dealer, 4096, 4);
+        sender.send(zmq::buffer(blob));
+        sender.send(zmq::const_buffer());
+    });
+
+    zmq::blob_receiver receiver(f.router);
+    std::vector<char> received(blob.size() + 100);
+    CHECK(receiver.recv(zmq::buffer(received)) == blob.size());
+    CHECK(std::equal(blob.begin(), blob.end(), received.begin()));
+    CHECK(receiver.sender().size() > 0u);
+    CHECK(receiver.recv(zmq::buffer(received)) == 0u);
+    sender_thread.join();
+}
+
+TEST_CASE("blob transfer rejects blobs larger than the buffer",
+          "[blob_transfer]")
+{
+    transfer_fixture f;
+    zmq::socket_t dealer = f.make_dealer();
+    const auto blob = make_blob(10000, 'x');
+
+    bool sender_rejected = false;
+    std::thread sender_thread([&dealer, &blob, &sender_rejected] {
+        zmq::blob_sender sender(dealer, 1000, 2);
+        try {
+            sender.send(zmq::buffer(blob));
+        }
+        catch (const std::length_error &) {
+            sender_rejected = true;
+        }
+        sender.send(zmq::buffer(blob.data(), 10));
+    });
+
+    zmq::blob_receiver receiver(f.router);
+    std::vector<char> received(100);
+    CHECK_THROWS_AS(receiver.recv(zmq::buffer(received)), std::length_error);
+    // the chunks still in flight are discarded
+    CHECK(receiver.recv(zmq::buffer(received)) == 10u);
+    CHECK(std::equal(blob.begin(), blob.begin() + 10, received.begin()));
+    sender_thread.join();
+    CHECK(sender_rejected);
+}
+
+TEST_CASE("blob transfer rejects chunks out of sequence", "[blob_transfer]")
+{
+    transfer_fixture f;
+    zmq::socket_t dealer = f.make_dealer();
+
+    // [blob id][offset][blob size], as written by blob_sender
+    const auto send_chunk = [&dealer](uint64_t offset, const std::string &data) {
+        unsigned char header[20] = {0, 0, 0, 7};
+        for (int i = 0; i < 8; ++i) {
+            const int shift = 56 - 8 * i;
+            header[4 + i] = static_cast<unsigned char>(offset >> shift);
+            header[12 + i] = static_cast<unsigned char>(uint64_t{12} >> shift);
+        }
+        dealer.send(zmq::buffer(header), zmq::send_flags::sndmore);
+        dealer.send(zmq::buffer(data), zmq::send_flags::none);
+    };
+    // [blob id][bytes received]
+    const auto recv_ack = [&dealer] {
+        zmq::message_t ack;
+        return dealer.recv(ack) ? ack.to_string() : std::string();
+    };
+    send_chunk(0, "abcd");
+    send_chunk(8, "ijkl");
+    send_chunk(4, "efgh"); // too late, the blob was abandoned
+
+    zmq::blob_receiver receiver(f.router);
+    std::vector<char> received(100);
+    CHECK_THROWS_AS(receiver.recv(zmq::buffer(received)), std::runtime_error);
+    CHECK(recv_ack() == std::string("\0\0\0\7\0\0\0\0\0\0\0\4", 12));
+    CHECK(recv_ack() == std::string("\0\0\0\7", 4) + std::string(8, '\xff'));
+
+    // the receiver moves on to the next blob
+    std::thread sender_thread(
+      [&dealer] { zmq::blob_sender(dealer, 4).send(zmq::str_buffer("next")); });
+    CHECK(receiver.recv(zmq::buffer(received)) == 4u);
+    CHECK(std::string(received.data(), 4) == "next");
+    sender_thread.join();
+}
+
+TEST_CASE("blob transfer keeps concurrent senders apart", "[blob_transfer]")
+{
+    transfer_fixture f;
+    zmq::socket_t first = f.make_dealer();
+    zmq::socket_t second = f.make_dealer();
+    const auto blob1 = make_blob(50000, '1');
+    const auto blob2 = make_blob(30000, '2');
+
+    std::thread thread1([&first, &blob1] {
+        zmq::blob_sender(first, 1024, 8).send(zmq::buffer(blob1));
+    });
+    std::thread thread2([&second, &blob2] {
+        zmq::blob_sender(second, 1024, 8).send(zmq::buffer(blob2));
+    });
+
+    zmq::blob_receiver receiver(f.router);
+    std::vector<char> received(blob1.size());
+    int seen = 0;
+    for (int i = 0; i < 2; ++i) {
+        const size_t size = receiver.recv(zmq::buffer(received));
+        const auto &expected = size == blob1.size() ? blob1 : blob2;
+        REQUIRE(size == expected.size());
+        CHECK(std::equal(expected.begin(), expected.end(), received.begin()));
+        seen |= size == blob1.size() ? 1 : 2;
+    }
+    CHECK(seen == 3);
+    thread1.join();
+    thread2.join();
+}
+
+#if CPPZMQ_HAS_MMAP
+TEST_CASE("blob transfer sends files", "[blob_transfer]")
+{
+    char path[] = "/tmp/cppzmq-blob-XXXXXX";
+    const int fd = ::mkstemp(path);
+    REQUIRE(fd >= 0);
+    ::close(fd);
+    const auto blob = make_blob(20000, 'f');
+    std::ofstream(path, std::ios::binary).write(blob.data(), blob.size());
+
+    transfer_fixture f;
+    zmq::socket_t dealer = f.make_dealer();
+    std::thread sender_thread(
+      [&dealer, &path] { zmq::blob_sender(dealer, 4096, 2).send_file(path); });
+
+    zmq::blob_receiver receiver(f.router);
+    std::vector<char> received(blob.size());
+    CHECK(receiver.recv(zmq::buffer(received)) == blob.size());
+    CHECK(received == blob);
+    sender_thread.join();
+    std::remove(path);
+}
+#endif
+
+#endif
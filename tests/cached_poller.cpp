@@ -0,0 +1,143 @@
+#include "testutil.hpp"
+#include <zmq_addon.hpp>
+
+#if defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11)                              \
+  && !defined(ZMQ_CPP11_PARTIAL) && defined(ZMQ_HAVE_POLLER)
+
+#include <array>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::cached_poller_t<>>::value,
+              "cached_poller_t should not be copy-constructible");
+
+namespace
+{
+// count connected PAIR sockets
+struct pairs
+{
+    explicit pairs(size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const std::string endpoint =
+              "inproc://cached_poller" + std::to_string(i);
+            servers.emplace_back(new zmq::socket_t(context, zmq::socket_type::pair));
+            clients.emplace_back(new zmq::socket_t(context, zmq::socket_type::pair));
+            servers.back()->bind(endpoint);
+            clients.back()->connect(endpoint);
+        }
+    }
+
+    zmq::context_t context;
+    std::vector<std::unique_ptr<zmq::socket_t>> servers;
+    std::vector<std::unique_ptr<zmq::socket_t>> clients;
+};
+} // namespace
+
+TEST_CASE("cached_poller add and remove", "[cached_poller]")
+{
+    pairs p(2);
+    zmq::cached_poller_t<> poller;
+    CHECK(poller.size() == 0u);
+    poller.add(*p.servers[0], zmq::event_flags::pollin);
+    poller.add(*p.servers[1], zmq::event_flags::pollin);
+    CHECK(poller.size() == 2u);
+    CHECK_THROWS_ZMQ_ERROR(EINVAL,
+                           poller.add(*p.servers[0], zmq::event_flags::pollin));
+    CHECK_THROWS_ZMQ_ERROR(ENOTSOCK,
+                           poller.add(zmq::socket_ref(), zmq::event_flags::pollin));
+
+    poller.remove(*p.servers[0]);
+    CHECK(poller.size() == 1u);
+    CHECK_THROWS_ZMQ_ERROR(EINVAL, poller.remove(*p.servers[0]));
+    CHECK_THROWS_ZMQ_ERROR(EINVAL, poller.touch(*p.servers[0]));
+    poller.add(*p.servers[0], zmq::event_flags::pollin);
+    CHECK(poller.size() == 2u);
+}
+
+TEST_CASE("cached_poller wait with no sockets throws", "[cached_poller]")
+{
+    zmq::cached_poller_t<> poller;
+    std::vector<zmq::cached_poller_t<>::event_type> events(1);
+    CHECK_THROWS_ZMQ_ERROR(EFAULT,
+                           poller.wait_all(events, std::chrono::milliseconds{-1}));
+    CHECK(poller.wait_all(events, std::chrono::milliseconds{0}) == 0u);
+}
+
+TEST_CASE("cached_poller wait", "[cached_poller]")
+{
+    pairs p(1);
+    zmq::socket_t &server = *p.servers[0];
+    zmq::cached_poller_t<int> poller;
+    int i = 42;
+    poller.add(server, zmq::event_flags::pollin, &i);
+    std::array<zmq::cached_poller_t<int>::event_type, 4> events;
+    CHECK(poller.wait_all(events, std::chrono::milliseconds{10}) == 0u);
+
+    p.clients[0]->send(zmq::str_buffer("hi"));
+    REQUIRE(poller.wait_all(events, std::chrono::milliseconds{500}) == 1u);
+    CHECK(events[0].socket == server);
+    CHECK(events[0].user_data == &i);
+    CHECK(events[0].events == zmq::event_flags::pollin);
+
+    // still ready as long as the message is not received
+    CHECK(poller.wait_all(events, std::chrono::milliseconds{0}) == 1u);
+
+    zmq::message_t msg;
+    REQUIRE(server.recv(msg));
+    CHECK(poller.wait_all(events, std::chrono::milliseconds{10}) == 0u);
+
+    poller.modify(server, zmq::event_flags::pollin | zmq::event_flags::pollout);
+    REQUIRE(poller.wait_all(events, std::chrono::milliseconds{0}) == 1u);
+    CHECK(events[0].events == zmq::event_flags::pollout);
+}
+
+TEST_CASE("cached_poller touch", "[cached_poller]")
+{
+    pairs p(2);
+    zmq::cached_poller_t<> poller;
+    poller.add(*p.servers[0], zmq::event_flags::pollin);
+    poller.add(*p.servers[1], zmq::event_flags::pollin);
+    std::array<zmq::cached_poller_t<>::event_type, 1> events;
+
+    p.clients[0]->send(zmq::str_buffer("a"));
+    p.clients[1]->send(zmq::str_buffer("b"));
+    REQUIRE(poller.wait_all(events, std::chrono::milliseconds{500}) == 1u);
+    zmq::socket_ref reported = events[0].socket;
+    zmq::socket_t &other =
+      reported == *p.servers[0] ? *p.servers[1] : *p.servers[0];
+
+    // the other socket is consumed without having been reported
+    zmq::message_t msg;
+    REQUIRE(other.recv(msg));
+    REQUIRE(reported.recv(msg));
+    poller.touch(other);
+    CHECK(poller.wait_all(events, std::chrono::milliseconds{10}) == 0u);
+}
+
+TEST_CASE("cached_poller rotates a full event buffer", "[cached_poller]")
+{
+    pairs p(64);
+    zmq::cached_poller_t<zmq::socket_t> poller;
+    for (auto &server : p.servers)
+        poller.add(*server, zmq::event_flags::pollin, server.get());
+    std::vector<zmq::cached_poller_t<zmq::socket_t>::event_type> events(0);
+    CHECK(poller.wait_all(events, std::chrono::milliseconds{0}) == 0u);
+
+    // a few active sockets and a buffer smaller than their number
+    for (size_t i = 0; i < 10; ++i)
+        p.clients[i * 5]->send(zmq::str_buffer("x"));
+    events.resize(4);
+    std::set<zmq::socket_t *> seen;
+    for (int round = 0; round < 3; ++round) {
+        const size_t count = poller.wait_all(events, std::chrono::milliseconds{500});
+        REQUIRE(count > 0u);
+        for (size_t i = 0; i < count; ++i)
+            seen.insert(events[i].user_data);
+    }
+    CHECK(seen.size() == 10u);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#include <zmq_addon.hpp>
+
+#include "testutil.hpp"
+
+#if defined(ZMQ_CPP11) && !defined(ZMQ_CPP11_PARTIAL) && defined(ZMQ_BUILD_DRAFT_API)
+
+#include <future>
+#include <set>
+#include <thread>
+
+TEST_CASE("core_executor one worker per cpu", "[core_executor]")
+{
+    zmq::context_t context;
+    zmq::core_executor executor(context);
+    CHECK(executor.size() >= 1u);
+
+    std::set<std::thread::id> ids;
+    for (size_t i = 0; i < executor.size(); ++i) {
+        std::promise<std::thread::id> id;
+        auto result = id.get_future();
+        CHECK(executor.post(i, [&id] { id.set_value(std::this_thread::get_id()); }));
+        ids.insert(result.get());
+    }
+    CHECK(ids.size() == executor.size());
+    CHECK(ids.count(std::this_thread::get_id()) == 0u);
+}
+
+TEST_CASE("core_executor selected cpus", "[core_executor]")
+{
+    zmq::context_t context;
+    // the first CPU this process may run on, not necessarily CPU 0
+    const int cpu = zmq::core_executor(context).cpu(0);
+    zmq::core_executor executor(context, {cpu});
+    REQUIRE(executor.size() == 1u);
+    CHECK(executor.cpu(0) == cpu);
+    CHECK_THROWS_AS(executor.post(1, [] {}), std::out_of_range);
+    CHECK_THROWS_AS(zmq::core_executor(context, {-1}), zmq::error_t);
+}
+
+TEST_CASE("core_executor adopt socket", "[core_executor]")
+{
+    common_server_client_setup s;
+    zmq::core_executor executor(s.context, {zmq::core_executor(s.context).cpu(0)});
+
+    std::promise<std::string> received;
+    auto result = received.get_future();
+    CHECK(executor.adopt(0, std::move(s.server),
+                         [&received](zmq::event_loop &loop, zmq::socket_t &socket) {
+                             loop.add(socket, zmq::event_flags::pollin,
+                                      [&socket, &received](zmq::event_flags) {
+                                          zmq::message_t msg;
+                                          (void) socket.recv(msg);
+                                          received.set_value(msg.to_string());
+                                      });
+                         }));
+    CHECK(!s.server);
+
+    CHECK(s.client.send(zmq::str_buffer("Hi")));
+    CHECK(result.get() == "Hi");
+}
+
+#endif
@@ -34,3 +34,69 @@ TEST_CASE("z85_decode", "[curve]")
     auto decoded = zmq::z85_decode("0rJua1Qkhq");
     CHECK(decoded == std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8});
 }
+
+TEST_CASE("z85_encode into buffer", "[curve]")
+{
+    const std::vector<uint8_t> data{1, 2, 3, 4, 5, 6, 7, 8};
+    char encoded[10];
+    CHECK(zmq::z85_encoded_size(data.size()) == 10);
+    CHECK(zmq::z85_encode(zmq::buffer(encoded), zmq::buffer(data)) == 10);
+    CHECK(std::string(encoded, 10) == "0rJua1Qkhq");
+
+    char too_small[9];
+    CHECK_THROWS_AS(zmq::z85_encode(zmq::buffer(too_small), zmq::buffer(data)),
+                    zmq::error_t);
+    CHECK_THROWS_AS(zmq::z85_encode(zmq::buffer(encoded), zmq::buffer(data, 7)),
+                    zmq::error_t);
+}
+
+TEST_CASE("z85_decode into buffer", "[curve]")
+{
+    uint8_t decoded[8];
+    CHECK(zmq::z85_decoded_size(10) == 8);
+    CHECK(zmq::z85_decode(zmq::buffer(decoded), zmq::str_buffer("0rJua1Qkhq")) == 8);
+    CHECK(std::vector<uint8_t>(decoded, decoded + 8)
+          == std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8});
+
+    CHECK_THROWS_AS(zmq::z85_decode(zmq::buffer(decoded), zmq::str_buffer("0rJu~")),
+                    zmq::error_t);
+    CHECK_THROWS_AS(zmq::z85_decode(zmq::buffer(decoded), zmq::str_buffer("%%%%%")),
+                    zmq::error_t);
+    CHECK_THROWS_AS(zmq::z85_decode(zmq::buffer(decoded), zmq::str_buffer("0rJu")),
+                    zmq::error_t);
+}
+
+TEST_CASE("z85 into buffer matches libzmq", "[curve]")
+{
+    std::vector<uint8_t> data(256);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7 + 3);
+    std::string encoded(zmq::z85_encoded_size(data.size()), '\0');
+    zmq::z85_encode(zmq::buffer(encoded), zmq::buffer(data));
+    CHECK(encoded == zmq::z85_encode(data));
+
+    std::vector<uint8_t> decoded(data.size());
+    zmq::z85_decode(zmq::buffer(decoded), zmq::buffer(encoded));
+    CHECK(decoded == data);
+}
+
+TEST_CASE("z85 partial padding round trip", "[curve]")
+{
+    const std::vector<uint8_t> data{0xFF, 0xFE, 0xFD, 0xFC, 0xFB, 0x00, 0x01};
+    for (size_t size = 0; size <= data.size(); ++size) {
+        const auto padding = zmq::z85_padding::partial;
+        std::string encoded(zmq::z85_encoded_size(size, padding), '\0');
+        CHECK(zmq::z85_encode(zmq::buffer(encoded), zmq::buffer(data, size), padding)
+              == encoded.size());
+        CHECK(encoded.size() == size / 4 * 5 + (size % 4 ? size % 4 + 1 : 0));
+
+        std::vector<uint8_t> decoded(zmq::z85_decoded_size(encoded.size(), padding));
+        CHECK(zmq::z85_decode(zmq::buffer(decoded), zmq::buffer(encoded), padding)
+              == size);
+        CHECK(decoded == std::vector<uint8_t>(data.begin(), data.begin() + size));
+    }
+    uint8_t decoded[4];
+    CHECK_THROWS_AS(zmq::z85_decode(zmq::buffer(decoded), zmq::str_buffer("0rJua1"),
+                                    zmq::z85_padding::partial),
+                    zmq::error_t);
+}
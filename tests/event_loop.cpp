@@ -0,0 +1,108 @@
+#include <zmq_addon.hpp>
+
+#include "testutil.hpp"
+
+#if defined(ZMQ_CPP11) && !defined(ZMQ_CPP11_PARTIAL) && defined(ZMQ_BUILD_DRAFT_API)
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("event_loop create destroy", "[event_loop]")
+{
+    zmq::context_t context;
+    zmq::event_loop loop(context);
+    CHECK(loop.empty());
+    CHECK(loop.timers().empty());
+}
+
+TEST_CASE("event_loop dispatches socket events", "[event_loop]")
+{
+    common_server_client_setup s;
+    zmq::event_loop loop(s.context);
+    std::string received;
+    loop.add(s.server, zmq::event_flags::pollin, [&](zmq::event_flags events) {
+        CHECK(events == zmq::event_flags::pollin);
+        zmq::message_t msg;
+        CHECK(s.server.recv(msg));
+        received = msg.to_string();
+    });
+    CHECK(loop.size() == 1u);
+
+    CHECK(s.client.send(zmq::str_buffer("Hi")));
+    CHECK(loop.run_once(std::chrono::milliseconds{-1}) == 1u);
+    CHECK(received == "Hi");
+
+    loop.remove(s.server);
+    CHECK(loop.empty());
+    CHECK_THROWS_AS(loop.remove(s.server), zmq::error_t);
+}
+
+TEST_CASE("event_loop waits for timers", "[event_loop]")
+{
+    zmq::context_t context;
+    zmq::event_loop loop(context);
+    int runs = 0;
+    loop.timers().add(std::chrono::milliseconds{2}, [&](zmq::timer_wheel::id_t) {
+        if (++runs == 3)
+            loop.stop();
+    });
+    // without the timer timeout this would block forever
+    loop.run();
+    CHECK(runs == 3);
+}
+
+TEST_CASE("event_loop runs posted tasks", "[event_loop]")
+{
+    zmq::context_t context;
+    zmq::event_loop loop(context);
+    bool ran = false;
+    CHECK(loop.post([&] { ran = true; }));
+    CHECK_THROWS_AS(loop.post(nullptr), std::invalid_argument);
+    loop.run_once(std::chrono::milliseconds{-1});
+    CHECK(ran);
+}
+
+TEST_CASE("event_loop post reports a full queue", "[event_loop]")
+{
+    zmq::context_t context;
+    zmq::event_loop loop(context, 4);
+    int runs = 0;
+    for (int i = 0; i < 4; ++i)
+        CHECK(loop.post([&] { ++runs; }));
+    zmq::event_loop::task_type task = [&] { ++runs; };
+    CHECK(!loop.post(std::move(task)));
+    CHECK(task); // left untouched
+    loop.run_once(std::chrono::milliseconds{0});
+    CHECK(runs == 4);
+    CHECK(loop.post(std::move(task)));
+}
+
+TEST_CASE("event_loop post from other threads", "[event_loop]")
+{
+    zmq::context_t context;
+    zmq::event_loop loop(context);
+    const int threads = 4;
+    const int posts = 1000;
+    int runs = 0;
+    std::atomic<int> done{0};
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([&] {
+            for (int i = 0; i < posts; ++i) {
+                while (!loop.post([&] { ++runs; }))
+                    std::this_thread::yield();
+            }
+            if (++done == threads)
+                while (!loop.post([&] { loop.stop(); }))
+                    std::this_thread::yield();
+        });
+    }
+    loop.run();
+    for (auto &producer : producers)
+        producer.join();
+    CHECK(runs == threads * posts);
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::last_value_cache>::value,
+              "last_value_cache should not be copy-constructible");
+
+namespace
+{
+void publish(zmq::last_value_cache &cache,
+             const std::string &topic,
+             const std::string &value)
+{
+    zmq::message_t topic_msg(topic);
+    zmq::message_t value_msg(value);
+    cache.publish(topic_msg, value_msg);
+}
+
+void check_recv(zmq::socket_t &socket,
+                const std::string &topic,
+                const std::string &value)
+{
+    zmq::message_t msg;
+    REQUIRE(socket.recv(msg));
+    CHECK(msg.to_string() == topic);
+    REQUIRE(msg.more());
+    REQUIRE(socket.recv(msg));
+    CHECK(msg.to_string() == value);
+    CHECK(!msg.more());
+}
+
+void subscribe(zmq::socket_t &xsub, const std::string &prefix)
+{
+    xsub.send(zmq::buffer('\x01' + prefix));
+}
+}
+
+TEST_CASE("last_value_cache rejects zero capacity", "[last_value_cache]")
+{
+    zmq::context_t context;
+    zmq::socket_t xpub(context, zmq::socket_type::xpub);
+    CHECK_THROWS_AS(zmq::last_value_cache(xpub, 0), std::invalid_argument);
+}
+
+TEST_CASE("last_value_cache keeps the latest value per topic",
+          "[last_value_cache]")
+{
+    zmq::context_t context;
+    zmq::socket_t xpub(context, zmq::socket_type::xpub);
+    zmq::socket_t xsub(context, zmq::socket_type::xsub);
+    xpub.bind("inproc://last_value_cache_latest");
+    xsub.connect("inproc://last_value_cache_latest");
+
+    zmq::last_value_cache cache(xpub, 8);
+    CHECK(cache.empty());
+    publish(cache, "a", "1");
+    publish(cache, "b", "2");
+    publish(cache, "a", "3");
+    CHECK(cache.size() == 2u);
+    REQUIRE(cache.find("a") != nullptr);
+    CHECK(cache.find("a")->to_string() == "3");
+    CHECK(cache.find("b")->to_string() == "2");
+    CHECK(cache.find("c") == nullptr);
+    CHECK(cache.evicted() == 0u);
+}
+
+TEST_CASE("last_value_cache shares the cached content", "[last_value_cache]")
+{
+    zmq::context_t context;
+    zmq::socket_t xpub(context, zmq::socket_type::xpub);
+    zmq::last_value_cache cache(xpub, 1);
+
+    // a value too large to be stored inline in zmq_msg_t
+    const std::string large(1024, 'x');
+    zmq::message_t topic(std::string("t"));
+    zmq::message_t value(large);
+    const void *data = value.data();
+    cache.publish(topic, value); // no peer, nothing sent
+    REQUIRE(cache.find("t") != nullptr);
+    CHECK(cache.find("t")->data() == data);
+}
+
+TEST_CASE("last_value_cache evicts the least recently published topic",
+          "[last_value_cache]")
+{
+    zmq::context_t context;
+    zmq::socket_t xpub(context, zmq::socket_type::xpub);
+    zmq::socket_t xsub(context, zmq::socket_type::xsub);
+    xpub.bind("inproc://last_value_cache_evict");
+    xsub.connect("inproc://last_value_cache_evict");
+
+    zmq::last_value_cache cache(xpub, 2);
+    publish(cache, "a", "1");
+    publish(cache, "b", "2");
+    publish(cache, "a", "3");
+    publish(cache, "c", "4");
+    CHECK(cache.size() == 2u);
+    CHECK(cache.evicted() == 1u);
+    CHECK(cache.find("b") == nullptr);
+    CHECK(cache.find("a")->to_string() == "3");
+    CHECK(cache.find("c")->to_string() == "4");
+}
+
+TEST_CASE("last_value_cache replays matching topics on subscription",
+          "[last_value_cache]")
+{
+    zmq::context_t context;
+    zmq::socket_t xpub(context, zmq::socket_type::xpub);
+    zmq::socket_t xsub(context, zmq::socket_type::xsub);
+    xpub.set(zmq::sockopt::xpub_verbose, true);
+    xpub.bind("inproc://last_value_cache_replay");
+
+    zmq::last_value_cache cache(xpub, 8);
+    publish(cache, "news.sport", "goal");
+    publish(cache, "weather", "rain");
+    publish(cache, "news.tech", "release");
+    CHECK(cache.process_subscriptions() == 0u);
+
+    // a late joiner
+    xsub.connect("inproc://last_value_cache_replay");
+
+    subscribe(xsub, "news");
+    size_t replayed = 0;
+    for (int i = 0; i < 1000 && replayed == 0; ++i) {
+        replayed = cache.process_subscriptions();
+        if (replayed == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    CHECK(replayed == 2u);
+    check_recv(xsub, "news.sport", "goal");
+    check_recv(xsub, "news.tech", "release");
+    // unsubscriptions are ignored
+    xsub.send(zmq::str_buffer("\x00news"));
+    CHECK(cache.process_subscriptions() == 0u);
+}
+
+TEST_CASE("last_value_cache resumes a replay that would block",
+          "[last_value_cache]")
+{
+    zmq::context_t context;
+    zmq::socket_t xpub(context, zmq::socket_type::xpub);
+    zmq::socket_t xsub(context, zmq::socket_type::xsub);
+    xpub.set(zmq::sockopt::xpub_nodrop, true);
+    xpub.set(zmq::sockopt::sndhwm, 2);
+    xsub.set(zmq::sockopt::rcvhwm, 2);
+    xpub.bind("inproc://last_value_cache_resume");
+
+    zmq::last_value_cache cache(xpub, 16);
+    std::vector<std::string> topics;
+    for (int i = 0; i < 10; ++i) {
+        topics.push_back("topic." + std::to_string(i));
+        publish(cache, topics.back(), std::to_string(i));
+    }
+    xsub.connect("inproc://last_value_cache_resume");
+    subscribe(xsub, "topic");
+
+    // the pipe holds only a few messages, so the replay takes several calls
+    size_t replayed = 0;
+    std::vector<std::string> received;
+    zmq::message_t msg;
+    for (int i = 0; i < 1000 && received.size() < topics.size(); ++i) {
+        replayed += cache.process_subscriptions();
+        while (xsub.recv(msg, zmq::recv_flags::dontwait)) {
+            REQUIRE(msg.more());
+            received.push_back(msg.to_string());
+            REQUIRE(xsub.recv(msg));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    CHECK(replayed == topics.size());
+    CHECK(received == topics);
+}
+
+#endif
@@ -0,0 +1,184 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::lb_broker>::value,
+              "lb_broker should not be copy-constructible");
+
+namespace
+{
+struct broker_fixture
+{
+    broker_fixture() :
+        frontend(context, zmq::socket_type::router),
+        backend(context, zmq::socket_type::router),
+        broker(frontend, backend)
+    {
+        frontend.bind("inproc://lb_broker_frontend");
+        backend.bind("inproc://lb_broker_backend");
+    }
+
+    // route until count messages were routed or a second passed
+    void route(size_t count)
+    {
+        size_t routed = 0;
+        for (int i = 0; i < 100 && routed < count; ++i)
+            routed += broker.poll(std::chrono::milliseconds{10});
+        CHECK(routed == count);
+    }
+
+    zmq::context_t context;
+    zmq::socket_t frontend;
+    zmq::socket_t backend;
+    zmq::lb_broker broker;
+};
+
+void ready(zmq::socket_t &worker, uint32_t credits)
+{
+    worker.send(zmq::const_buffer(nullptr, 0), zmq::send_flags::sndmore);
+    worker.send(zmq::lb_broker::credit_frame(credits), zmq::send_flags::none);
+}
+
+void request(zmq::socket_t &client, const std::string &body)
+{
+    client.send(zmq::const_buffer(nullptr, 0), zmq::send_flags::sndmore);
+    client.send(zmq::buffer(body));
+}
+
+// echo one request back with a prefix, returning its body
+std::string serve(zmq::socket_t &worker, const std::string &prefix)
+{
+    std::vector<zmq::message_t> parts;
+    if (!zmq::recv_multipart(worker, std::back_inserter(parts),
+                             zmq::recv_flags::dontwait)
+        || parts.size() != 4 || parts[0].size() != 0 || parts[2].size() != 0)
+        return {};
+    const std::string body = parts[3].to_string();
+    parts[3] = zmq::message_t(prefix + body);
+    zmq::send_multipart(worker, parts);
+    return body;
+}
+}
+
+TEST_CASE("lb_broker routes requests and replies", "[lb_broker]")
+{
+    broker_fixture f;
+    zmq::socket_t worker(f.context, zmq::socket_type::dealer);
+    zmq::socket_t client(f.context, zmq::socket_type::dealer);
+    worker.connect("inproc://lb_broker_backend");
+    client.connect("inproc://lb_broker_frontend");
+
+    ready(worker, 1);
+    f.route(1);
+    CHECK(f.broker.workers() == 1u);
+    CHECK(f.broker.credits() == 1u);
+
+    request(client, "ping");
+    f.route(1);
+    CHECK(f.broker.credits() == 0u);
+    CHECK(f.broker.requests() == 1u);
+    CHECK(serve(worker, "re:") == "ping");
+
+    f.route(1);
+    CHECK(f.broker.replies() == 1u);
+    CHECK(f.broker.credits() == 1u);
+
+    std::vector<zmq::message_t> reply;
+    REQUIRE(zmq::recv_multipart(client, std::back_inserter(reply)));
+    REQUIRE(reply.size() == 2u);
+    CHECK(reply[0].size() == 0u);
+    CHECK(reply[1].to_string() == "re:ping");
+}
+
+TEST_CASE("lb_broker holds requests without credits", "[lb_broker]")
+{
+    broker_fixture f;
+    zmq::socket_t client(f.context, zmq::socket_type::dealer);
+    client.connect("inproc://lb_broker_frontend");
+
+    request(client, "waiting");
+    CHECK(f.broker.poll(std::chrono::milliseconds{10}) == 0u);
+    CHECK(!f.broker.route_frontend());
+    CHECK(f.broker.requests() == 0u);
+
+    zmq::socket_t worker(f.context, zmq::socket_type::dealer);
+    worker.connect("inproc://lb_broker_backend");
+    worker.send(zmq::str_buffer(""), zmq::send_flags::sndmore);
+    worker.send(zmq::str_buffer("READY")); // one credit
+    f.route(2);
+    CHECK(f.broker.requests() == 1u);
+
+    std::string body;
+    for (int i = 0; i < 100 && body.empty(); ++i) {
+        body = serve(worker, "");
+        if (body.empty())
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    CHECK(body == "waiting");
+}
+
+TEST_CASE("lb_broker spends credits in the order they were granted",
+          "[lb_broker]")
+{
+    broker_fixture f;
+    zmq::socket_t fast(f.context, zmq::socket_type::dealer);
+    zmq::socket_t slow(f.context, zmq::socket_type::dealer);
+    zmq::socket_t client(f.context, zmq::socket_type::dealer);
+    fast.connect("inproc://lb_broker_backend");
+    slow.connect("inproc://lb_broker_backend");
+    client.connect("inproc://lb_broker_frontend");
+
+    ready(fast, 2);
+    f.route(1);
+    ready(slow, 1);
+    f.route(1);
+    CHECK(f.broker.workers() == 2u);
+    CHECK(f.broker.credits() == 3u);
+
+    for (int i = 0; i < 3; ++i)
+        request(client, std::to_string(i));
+    f.route(3);
+    CHECK(f.broker.credits() == 0u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    CHECK(serve(fast, "") == "0");
+    CHECK(serve(fast, "") == "1");
+    CHECK(serve(slow, "") == "2");
+}
+
+TEST_CASE("lb_broker only reads credits from credit frames", "[lb_broker]")
+{
+    broker_fixture f;
+    zmq::socket_t worker(f.context, zmq::socket_type::dealer);
+    worker.connect("inproc://lb_broker_backend");
+
+    // a four byte payload is not a credit count
+    worker.send(zmq::str_buffer(""), zmq::send_flags::sndmore);
+    worker.send(zmq::str_buffer("LOAD"));
+    f.route(1);
+    CHECK(f.broker.credits() == 1u);
+
+    ready(worker, 2);
+    f.route(1);
+    CHECK(f.broker.credits() == 3u);
+    CHECK(f.broker.workers() == 1u);
+}
+
+TEST_CASE("lb_broker drops malformed worker messages", "[lb_broker]")
+{
+    broker_fixture f;
+    zmq::socket_t worker(f.context, zmq::socket_type::dealer);
+    worker.connect("inproc://lb_broker_backend");
+
+    worker.send(zmq::str_buffer("no delimiter"));
+    f.route(1);
+    CHECK(f.broker.dropped() == 1u);
+    CHECK(f.broker.workers() == 0u);
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#if defined(ZMQ_CPP11) && CPPZMQ_HAS_MMAP
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace
+{
+struct temp_file
+{
+    temp_file()
+    {
+        char name[] = "/tmp/cppzmq-mapped-XXXXXX";
+        const int fd = ::mkstemp(name);
+        REQUIRE(fd >= 0);
+        ::close(fd);
+        path = name;
+    }
+    ~temp_file() { std::remove(path.c_str()); }
+
+    void write(const std::string &content) const
+    {
+        std::ofstream(path, std::ios::binary) << content;
+    }
+
+    std::string read() const
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    }
+
+    std::string path;
+};
+}
+
+TEST_CASE("mapped_message maps a whole file", "[mapped_message]")
+{
+    temp_file file;
+    file.write("hello mapped world");
+
+    zmq::message_t msg = zmq::mapped_message(file.path);
+    CHECK(msg.to_string() == "hello mapped world");
+}
+
+TEST_CASE("mapped_message maps a slice at an unaligned offset",
+          "[mapped_message]")
+{
+    temp_file file;
+    std::string content(3 * 4096, 'a');
+    content.replace(5000, 6, "needle");
+    file.write(content);
+
+    CHECK(zmq::mapped_message(file.path, 5000, 6).to_string() == "needle");
+    // clamped to the end of the file
+    CHECK(zmq::mapped_message(file.path, content.size() - 3).size() == 3u);
+    CHECK(zmq::mapped_message(file.path, content.size()).size() == 0u);
+    CHECK_THROWS_AS(zmq::mapped_message(file.path, content.size() + 1),
+                    zmq::error_t);
+}
+
+TEST_CASE("mapped_message reports missing files", "[mapped_message]")
+{
+    CHECK_THROWS_AS(zmq::mapped_message("/nonexistent/cppzmq-mapped"),
+                    zmq::error_t);
+}
+
+TEST_CASE("mapped_message can be sent", "[mapped_message]")
+{
+    temp_file file;
+    file.write("payload from a file");
+
+    zmq::context_t context;
+    zmq::socket_t push(context, zmq::socket_type::push);
+    zmq::socket_t pull(context, zmq::socket_type::pull);
+    pull.bind("inproc://mapped_message");
+    push.connect("inproc://mapped_message");
+
+    CHECK(push.send(zmq::mapped_message(file.path), zmq::send_flags::none));
+    zmq::message_t received;
+    REQUIRE(pull.recv(received));
+    CHECK(received.to_string() == "payload from a file");
+}
+
+TEST_CASE("recv_multipart_into writes parts into a mapped file",
+          "[mapped_message]")
+{
+    temp_file file;
+    zmq::context_t context;
+    zmq::socket_t push(context, zmq::socket_type::push);
+    zmq::socket_t pull(context, zmq::socket_type::pull);
+    pull.bind("inproc://mapped_file");
+    push.connect("inproc://mapped_file");
+
+    {
+        zmq::mapped_file output(file.path, 10);
+        CHECK(output.size() == 10u);
+
+        std::array<zmq::const_buffer, 2> parts = {zmq::str_buffer("abc"),
+                                                  zmq::str_buffer("def")};
+        REQUIRE(zmq::send_multipart(push, parts));
+        size_t offset = 2;
+        const auto n = zmq::recv_multipart_into(pull, output, offset);
+        REQUIRE(n);
+        CHECK(*n == 2u);
+        CHECK(offset == 8u);
+
+        push.send(zmq::str_buffer("too long"));
+        CHECK_THROWS_AS(zmq::recv_multipart_into(pull, output, offset),
+                        std::length_error);
+        CHECK(offset == 8u);
+
+        zmq::mapped_file moved(std::move(output));
+        CHECK(output.data() == nullptr);
+        moved.sync();
+    }
+    CHECK(file.read().substr(0, 8) == std::string("\0\0abcdef", 8));
+}
+
+#endif
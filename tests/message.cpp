@@ -1,5 +1,7 @@
 #include <catch2/catch_all.hpp>
 #include <zmq.hpp>
+#include <set>
+#include <unordered_set>
 
 #if defined(ZMQ_CPP11)
 static_assert(!std::is_copy_constructible<zmq::message_t>::value,
@@ -245,6 +247,166 @@ TEST_CASE("message to debug string", "[message]")
     CHECK(d.str(2) == "zmq::message_t [size 006] (0102... too big to print)");
 }
 
+TEST_CASE("message to debug string without allocating", "[message]")
+{
+    const zmq::message_t c("ascii\x01\x02\x03%%%\x04\x05\x06###", 17);
+    const std::string expected = c.str();
+
+    std::string out = "previous content";
+    c.str(out);
+    CHECK(out == expected);
+    c.str(out, 10);
+    CHECK(out == c.str(10));
+
+    char buf[128];
+    CHECK(c.str(buf, sizeof(buf)) == expected.size());
+    CHECK(std::string(buf) == expected);
+
+    char small[8];
+    CHECK(c.str(small, sizeof(small)) == expected.size());
+    CHECK(std::string(small) == expected.substr(0, 7));
+
+    // staged in pieces when the dump might not fit
+    std::string mixed(200, '\0');
+    for (size_t i = 0; i < mixed.size(); ++i)
+        mixed[i] = i % 50 < 25 ? static_cast<char>('a' + i % 26) : '\x01';
+    const zmq::message_t m(mixed.data(), mixed.size());
+    const std::string whole = m.str();
+    CHECK(m.str(buf, sizeof(buf)) == whole.size());
+    CHECK(std::string(buf) == whole.substr(0, sizeof(buf) - 1));
+
+    const zmq::message_t large(std::string(1234, 'x').data(), 1234);
+    const std::string elided = "zmq::message_t [size 1234] (... too big to print)";
+    CHECK(large.str(buf, sizeof(buf), 0) == elided.size());
+    CHECK(std::string(buf) == elided);
+}
+
+#ifdef ZMQ_CPP11
+namespace
+{
+struct telemetry_record
+{
+    telemetry_record() = default;
+    telemetry_record(uint32_t i, double v) : id(i), value(v) {}
+    uint32_t id;
+    double value;
+};
+}
+
+TEST_CASE("message emplace", "[message]")
+{
+    zmq::message_t msg("foo", 3);
+    auto &rec = msg.emplace<telemetry_record>(42u, 1.5);
+    CHECK(msg.size() == sizeof(telemetry_record));
+    CHECK(static_cast<void *>(&rec) == msg.data());
+    CHECK(rec.id == 42u);
+    CHECK(rec.value == 1.5);
+}
+
+namespace
+{
+struct aggregate_record
+{
+    uint32_t id;
+    double value;
+};
+}
+
+TEST_CASE("message emplace aggregate", "[message]")
+{
+    zmq::message_t msg;
+    auto &rec = msg.emplace<aggregate_record>(42u, 1.5);
+    CHECK(msg.size() == sizeof(aggregate_record));
+    CHECK(rec.id == 42u);
+    CHECK(rec.value == 1.5);
+
+    const auto &zeroed = msg.emplace<aggregate_record>();
+    CHECK(zeroed.id == 0u);
+    CHECK(zeroed.value == 0.0);
+}
+
+TEST_CASE("message_view single", "[message]")
+{
+    zmq::message_t msg;
+    msg.emplace<telemetry_record>(7u, 2.5);
+    const zmq::message_view<telemetry_record> view(msg);
+    CHECK(view->id == 7u);
+    CHECK((*view).value == 2.5);
+    CHECK(&view.get() == msg.data<telemetry_record>());
+}
+
+TEST_CASE("message_view size mismatch", "[message]")
+{
+    const zmq::message_t msg(sizeof(telemetry_record) + 1);
+    CHECK_THROWS_AS(zmq::message_view<telemetry_record>(msg), std::runtime_error);
+}
+
+TEST_CASE("message_view misaligned", "[message]")
+{
+    alignas(uint32_t) const unsigned char bytes[2 * sizeof(uint32_t)] = {};
+    CHECK_THROWS_AS(zmq::message_view<uint32_t>(zmq::buffer(bytes + 1, 4)),
+                    std::runtime_error);
+}
+
+TEST_CASE("message_view array", "[message]")
+{
+    const std::vector<uint32_t> values = {1, 2, 3};
+    const zmq::message_t msg(values);
+    const zmq::message_view<uint32_t[]> view(msg);
+    REQUIRE(view.size() == 3);
+    CHECK(view[0] == 1);
+    CHECK(view[2] == 3);
+    CHECK(std::equal(view.begin(), view.end(), values.begin()));
+
+    const zmq::message_t empty;
+    CHECK(zmq::message_view<uint32_t[]>(empty).empty());
+
+    const zmq::message_t odd(5);
+    CHECK_THROWS_AS(zmq::message_view<uint32_t[]>(odd), std::runtime_error);
+}
+
+TEST_CASE("message hash", "[message]")
+{
+    std::vector<unsigned char> data(1100);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<unsigned char>(i * 7 + 3);
+    // the same bytes at a different alignment
+    std::vector<unsigned char> shifted(data.size() + 1);
+
+    std::set<uint64_t> hashes;
+    for (size_t n = 0; n < data.size(); n += (n < 300 ? 1 : 97)) {
+        std::copy(data.begin(), data.begin() + n, shifted.begin() + 1);
+        const uint64_t h = zmq::hash(zmq::buffer(data.data(), n));
+        CHECK(zmq::hash(zmq::buffer(shifted.data() + 1, n)) == h);
+        CHECK(zmq::hash(zmq::buffer(data.data(), n), 1) != h);
+        CHECK(hashes.insert(h).second);
+
+        // flipping any single bit changes the hash
+        for (size_t i = 0; i < n; i += (n < 20 ? 1 : n / 7)) {
+            shifted[1 + i] ^= 0x10;
+            CHECK(zmq::hash(zmq::buffer(shifted.data() + 1, n)) != h);
+            shifted[1 + i] ^= 0x10;
+        }
+    }
+
+    const zmq::message_t msg(data.data(), 100);
+    CHECK(zmq::hash(msg) == zmq::hash(zmq::buffer(data.data(), 100)));
+    CHECK(std::hash<zmq::message_t>()(msg)
+          == static_cast<size_t>(zmq::hash(msg)));
+}
+
+TEST_CASE("message as unordered_set key", "[message]")
+{
+    std::unordered_set<zmq::message_t> seen;
+    CHECK(seen.emplace(std::string("alpha")).second);
+    CHECK(seen.emplace(std::string("beta")).second);
+    CHECK_FALSE(seen.emplace(std::string("alpha")).second);
+    CHECK(seen.size() == 2u);
+    CHECK(seen.count(zmq::message_t(std::string("beta"))) == 1u);
+    CHECK(seen.count(zmq::message_t(std::string("gamma"))) == 0u);
+}
+#endif
+
 #if defined(ZMQ_BUILD_DRAFT_API) && ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 2, 0)
 TEST_CASE("message routing id persists", "[message]")
 {
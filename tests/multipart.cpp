@@ -209,4 +209,23 @@ TEST_CASE("multipart legacy test", "[multipart]")
     assert(received.empty());
     assert(str == "One-hundred");
 }
+
+TEST_CASE("multipart to debug string", "[multipart]")
+{
+    zmq::multipart_t multipart;
+    multipart.addstr("text");
+    multipart.addmem("\x01\xab", 2);
+    multipart.addmem(std::string(1000, 'x').data(), 1000);
+    const std::string expected =
+      "\n[004] text\n[002] 01ab\n[1000] ... (too big to print)";
+    CHECK(multipart.str() == expected);
+
+    std::string out = "previous content";
+    multipart.str(out);
+    CHECK(out == expected);
+
+    char buf[16];
+    CHECK(multipart.str(buf, sizeof(buf)) == expected.size());
+    CHECK(std::string(buf) == expected.substr(0, 15));
+}
 #endif
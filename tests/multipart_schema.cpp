@@ -0,0 +1,83 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+namespace
+{
+struct header_t
+{
+    uint32_t seq;
+    uint16_t kind;
+};
+
+using schema_t = zmq::multipart_schema<zmq::const_buffer, header_t, uint32_t[]>;
+}
+
+static_assert(schema_t::frame_count == 3, "");
+static_assert(std::is_same<schema_t::view_type<0>, zmq::const_buffer>::value, "");
+static_assert(
+  std::is_same<schema_t::view_type<1>, zmq::message_view<header_t>>::value, "");
+static_assert(
+  std::is_same<schema_t::view_type<2>, zmq::message_view<uint32_t[]>>::value, "");
+
+TEST_CASE("multipart_schema send and recv", "[multipart_schema]")
+{
+    zmq::context_t context(1);
+    zmq::socket_t output(context, ZMQ_PAIR);
+    zmq::socket_t input(context, ZMQ_PAIR);
+    output.bind("inproc://multipart_schema.test");
+    input.connect("inproc://multipart_schema.test");
+
+    schema_t schema;
+
+    SECTION("round trip")
+    {
+        const header_t header{42, 7};
+        const std::vector<uint32_t> payload = {1, 2, 3};
+        auto sent = schema_t::send(
+          input, std::forward_as_tuple(zmq::str_buffer("id"), header,
+                                       zmq::buffer(payload)));
+        REQUIRE(sent);
+        CHECK(*sent == 3);
+
+        auto ret = schema.recv(output);
+        REQUIRE(ret);
+        CHECK(*ret == 3);
+        CHECK(schema.get<0>().size() == 2);
+        CHECK(schema.get<1>()->seq == 42);
+        CHECK(schema.get<1>()->kind == 7);
+        const auto values = schema.get<2>();
+        REQUIRE(values.size() == 3);
+        CHECK(values[2] == 3);
+
+        const auto views = schema.views();
+        CHECK(std::get<1>(views)->seq == 42);
+        CHECK(schema.part(0).to_string() == "id");
+    }
+    SECTION("too few parts")
+    {
+        input.send(zmq::str_buffer("id"), zmq::send_flags::sndmore);
+        input.send(zmq::buffer(&input, 0));
+        CHECK_THROWS_AS(schema.recv(output), std::runtime_error);
+    }
+    SECTION("too many parts")
+    {
+        std::array<zmq::const_buffer, 4> parts = {};
+        zmq::send_multipart(input, parts);
+        CHECK_THROWS_AS(schema.recv(output), std::runtime_error);
+    }
+    SECTION("frame size mismatch")
+    {
+        const uint32_t seq = 1;
+        zmq::send_multipart(input, std::array<zmq::const_buffer, 3>{
+                                     {zmq::str_buffer("id"), zmq::buffer(&seq, 4),
+                                      zmq::const_buffer()}});
+        CHECK_THROWS_AS(schema.recv(output), std::runtime_error);
+    }
+    SECTION("recv no messages, dontwait")
+    {
+        CHECK_FALSE(schema.recv(output, zmq::recv_flags::dontwait));
+    }
+}
+
+#endif
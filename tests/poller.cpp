@@ -5,6 +5,7 @@
 
 #include <array>
 #include <memory>
+#include <set>
 
 #ifdef ZMQ_CPP17
 static_assert(std::is_nothrow_swappable_v<zmq::poller_t<>>);
@@ -390,4 +391,34 @@ TEST_CASE("poller remove from handler", "[poller]")
     CHECK(ITER_NO == poller.wait_all(events, std::chrono::milliseconds{-1}));
 }
 
+TEST_CASE("poller wait_all into a smaller buffer rotates", "[poller]")
+{
+    constexpr size_t ITER_NO = 10;
+
+    std::vector<common_server_client_setup> setup_list;
+    for (size_t i = 0; i < ITER_NO; ++i)
+        setup_list.emplace_back(common_server_client_setup{});
+
+    zmq::poller_t<zmq::socket_t> poller;
+    for (auto &s : setup_list) {
+        CHECK_NOTHROW(poller.add(s.server, zmq::event_flags::pollin, &s.server));
+        CHECK_NOTHROW(s.client.send(zmq::message_t{hi_str}, zmq::send_flags::none));
+    }
+    for (auto &s : setup_list) {
+        zmq::pollitem_t items[] = {{s.server, 0, ZMQ_POLLIN, 0}};
+        zmq::poll(&items[0], 1);
+    }
+
+    // nothing is received, so every wait sees all sockets ready
+    std::array<zmq::poller_event<zmq::socket_t>, 3> events;
+    std::set<zmq::socket_t *> seen;
+    for (size_t i = 0; i < 4; ++i) {
+        REQUIRE(3 == poller.wait_all(events.data(), events.size(),
+                                     std::chrono::milliseconds{-1}));
+        for (const auto &event : events)
+            seen.insert(event.user_data);
+    }
+    CHECK(ITER_NO == seen.size());
+}
+
 #endif
@@ -0,0 +1,155 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::publisher_hub>::value,
+              "publisher_hub should not be copy-constructible");
+
+// Subscriptions travel to the publisher asynchronously, anything
+// published before they arrive is dropped. Publish probes until one is
+// received, then drain the probes still queued.
+static void await_subscription(zmq::socket_t &pub, zmq::socket_t &sub)
+{
+    zmq::message_t msg;
+    for (;;) {
+        pub.send(zmq::str_buffer("probe"), zmq::send_flags::none);
+        if (sub.recv(msg, zmq::recv_flags::dontwait))
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    while (sub.recv(msg, zmq::recv_flags::dontwait)) {
+    }
+}
+
+TEST_CASE("publisher_hub producer reports a full ring", "[publisher_hub]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    sub.bind("inproc://publisher_hub_full");
+    sub.set(zmq::sockopt::subscribe, "");
+    zmq::socket_t pub(context, zmq::socket_type::pub);
+    pub.connect("inproc://publisher_hub_full");
+    await_subscription(pub, sub);
+
+    zmq::publisher_hub hub(std::move(pub), 2);
+    auto &producer = hub.make_producer();
+    CHECK(hub.producers() == 1u);
+    CHECK(producer.try_publish(zmq::str_buffer("A"), zmq::str_buffer("1")));
+    CHECK(producer.try_publish(zmq::str_buffer("B"), zmq::str_buffer("2")));
+
+    zmq::message_t topic(std::string("C"));
+    zmq::message_t payload(std::string("3"));
+    CHECK(!producer.try_publish(std::move(topic), std::move(payload)));
+    CHECK(topic.to_string() == "C"); // left untouched
+    CHECK(payload.to_string() == "3");
+
+    CHECK(hub.wait(std::chrono::milliseconds{0}));
+    CHECK(hub.flush() == 2u);
+    CHECK(!hub.wait(std::chrono::milliseconds{1}));
+    CHECK(producer.try_publish(std::move(topic), std::move(payload)));
+    CHECK(hub.flush() == 1u);
+    CHECK(hub.sent() == 3u);
+
+    std::vector<zmq::message_t> msgs;
+    for (const char *expected : {"A", "B", "C"}) {
+        msgs.clear();
+        REQUIRE(zmq::recv_multipart(sub, std::back_inserter(msgs),
+                                    zmq::recv_flags::dontwait));
+        REQUIRE(msgs.size() == 2u);
+        CHECK(msgs[0].to_string() == expected);
+    }
+}
+
+TEST_CASE("publisher_hub flush takes turns between producers",
+          "[publisher_hub]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    sub.set(zmq::sockopt::rcvhwm, 1);
+    sub.set(zmq::sockopt::subscribe, "");
+    sub.bind("inproc://publisher_hub_turns");
+    zmq::socket_t pub(context, zmq::socket_type::xpub);
+    pub.set(zmq::sockopt::xpub_nodrop, true);
+    pub.set(zmq::sockopt::sndhwm, 1);
+    pub.connect("inproc://publisher_hub_turns");
+    await_subscription(pub, sub);
+
+    zmq::publisher_hub hub(std::move(pub), 16);
+    auto &first = hub.make_producer();
+    auto &second = hub.make_producer();
+    for (int i = 0; i < 8; ++i) {
+        REQUIRE(first.try_publish(zmq::str_buffer("A"), zmq::str_buffer("1")));
+        REQUIRE(second.try_publish(zmq::str_buffer("B"), zmq::str_buffer("2")));
+    }
+
+    // the pipe fills up within the first producer's batch, the next flush
+    // starts with the second producer
+    std::string topics;
+    std::vector<zmq::message_t> msgs;
+    for (int i = 0; i < 2; ++i) {
+        CHECK(hub.flush() > 0u);
+        while (zmq::recv_multipart(sub, std::back_inserter(msgs),
+                                   zmq::recv_flags::dontwait)) {
+            topics += msgs[0].to_string();
+            msgs.clear();
+        }
+    }
+    REQUIRE(!topics.empty());
+    CHECK(topics.front() == 'A');
+    CHECK(topics.find('B') != std::string::npos);
+}
+
+TEST_CASE("publisher_hub many producers", "[publisher_hub]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    sub.set(zmq::sockopt::rcvhwm, 0);
+    sub.set(zmq::sockopt::subscribe, "");
+    sub.bind("inproc://publisher_hub_producers");
+    zmq::socket_t pub(context, zmq::socket_type::pub);
+    pub.set(zmq::sockopt::sndhwm, 0);
+    pub.connect("inproc://publisher_hub_producers");
+    await_subscription(pub, sub);
+
+    const int producers = 4;
+    const int messages = 1000;
+    zmq::publisher_hub hub(std::move(pub), 16, producers);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; ++t) {
+        threads.emplace_back([&hub, t] {
+            auto &producer = hub.make_producer();
+            for (int i = 0; i < messages; ++i) {
+                while (!producer.try_publish(zmq::const_buffer(&t, sizeof(t)),
+                                             zmq::const_buffer(&i, sizeof(i))))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    while (hub.sent() < static_cast<size_t>(producers * messages)) {
+        hub.wait(std::chrono::milliseconds{10});
+        hub.flush();
+    }
+    for (auto &thread : threads)
+        thread.join();
+    CHECK_THROWS_AS(hub.make_producer(), std::length_error);
+
+    std::vector<int> next(producers, 0);
+    std::vector<zmq::message_t> msgs;
+    while (zmq::recv_multipart(sub, std::back_inserter(msgs),
+                               zmq::recv_flags::dontwait)) {
+        REQUIRE(msgs.size() == 2u);
+        const int t = *msgs[0].data<int>();
+        // each producer's messages arrive in order
+        CHECK(*msgs[1].data<int>() == next[static_cast<size_t>(t)]++);
+        msgs.clear();
+    }
+    for (const int count : next)
+        CHECK(count == messages);
+}
+
+#endif
@@ -147,4 +147,68 @@ TEST_CASE("recv_multipart_n test", "[recv_multipart]")
     }
 }
 
+TEST_CASE("recv_multipart_into test", "[recv_multipart]")
+{
+    zmq::context_t context(1);
+    zmq::socket_t output(context, ZMQ_PAIR);
+    zmq::socket_t input(context, ZMQ_PAIR);
+    output.bind("inproc://multipart.test");
+    input.connect("inproc://multipart.test");
+
+    zmq::recv_arena arena(256);
+
+    SECTION("send 2 messages")
+    {
+        input.send(zmq::str_buffer("hello"), zmq::send_flags::sndmore);
+        input.send(zmq::str_buffer("world!"));
+
+        auto ret = zmq::recv_multipart_into(output, arena);
+        REQUIRE(ret);
+        CHECK(*ret == 2);
+        REQUIRE(arena.parts().size() == 2);
+        CHECK(arena.parts()[0].size() == 5);
+        CHECK(arena.parts()[1].size() == 6);
+        CHECK(0 == memcmp(arena.parts()[0].data(), "hello", 5));
+        CHECK(0 == memcmp(arena.parts()[1].data(), "world!", 6));
+        CHECK(reinterpret_cast<uintptr_t>(arena.parts()[1].data())
+                % alignof(std::max_align_t)
+              == 0);
+    }
+    SECTION("batch and reset")
+    {
+        input.send(zmq::str_buffer("hello"));
+        input.send(zmq::str_buffer("world!"));
+
+        REQUIRE(zmq::recv_multipart_into(output, arena));
+        REQUIRE(zmq::recv_multipart_into(output, arena));
+        CHECK(arena.parts().size() == 2);
+        CHECK(arena.size() > 11);
+
+        arena.reset();
+        CHECK(arena.empty());
+        CHECK(arena.size() == 0);
+        CHECK(arena.capacity() == 256);
+    }
+    SECTION("send no messages, dontwait")
+    {
+        auto ret =
+          zmq::recv_multipart_into(output, arena, zmq::recv_flags::dontwait);
+        CHECK_FALSE(ret);
+        CHECK(arena.empty());
+    }
+    SECTION("capacity exceeded")
+    {
+        input.send(zmq::const_buffer(std::string(300, 'x').data(), 300));
+
+        CHECK_THROWS_AS(zmq::recv_multipart_into(output, arena),
+                        std::length_error);
+        CHECK(arena.empty());
+    }
+    SECTION("recv with invalid socket")
+    {
+        CHECK_THROWS_AS(zmq::recv_multipart_into(zmq::socket_ref(), arena),
+                        zmq::error_t);
+    }
+}
+
 #endif
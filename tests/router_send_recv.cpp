@@ -0,0 +1,108 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <array>
+#include <string>
+#include <vector>
+
+TEST_CASE("router_send and router_recv", "[router]")
+{
+    zmq::context_t context;
+    zmq::socket_t router(context, zmq::socket_type::router);
+    zmq::socket_t dealer(context, zmq::socket_type::dealer);
+    dealer.set(zmq::sockopt::routing_id, "client");
+    router.bind("inproc://router_send_recv");
+    dealer.connect("inproc://router_send_recv");
+
+    SECTION("request with delimiter, single body")
+    {
+        std::array<zmq::const_buffer, 2> request = {zmq::const_buffer(),
+                                                    zmq::str_buffer("ping")};
+        REQUIRE(zmq::send_multipart(dealer, request));
+
+        zmq::message_t identity;
+        zmq::message_t body;
+        const auto received = zmq::router_recv(router, identity, body);
+        REQUIRE(received);
+        CHECK(*received == 1u);
+        CHECK(identity.to_string() == "client");
+        CHECK(body.to_string() == "ping");
+
+        const auto sent =
+          zmq::router_send(router, zmq::buffer(identity.data(), identity.size()),
+                           zmq::str_buffer("pong"));
+        REQUIRE(sent);
+        CHECK(*sent == 3u);
+
+        std::vector<zmq::message_t> reply;
+        REQUIRE(zmq::recv_multipart(dealer, std::back_inserter(reply)));
+        REQUIRE(reply.size() == 2u);
+        CHECK(reply[0].size() == 0u);
+        CHECK(reply[1].to_string() == "pong");
+    }
+
+    SECTION("request without delimiter, multipart body")
+    {
+        std::array<zmq::const_buffer, 3> request = {
+          zmq::str_buffer("a"), zmq::const_buffer(), zmq::str_buffer("c")};
+        REQUIRE(zmq::send_multipart(dealer, request));
+
+        zmq::message_t identity;
+        std::array<zmq::message_t, 4> body;
+        const auto received =
+          zmq::router_recv(router, identity, body.data(), body.size());
+        REQUIRE(received);
+        CHECK(*received == 3u);
+        CHECK(body[0].to_string() == "a");
+        CHECK(body[1].size() == 0u);
+        CHECK(body[2].to_string() == "c");
+
+        std::array<zmq::message_t, 2> reply_body = {
+          zmq::message_t(std::string("x")), zmq::message_t(std::string("yz"))};
+        const auto sent = zmq::router_send(
+          router, zmq::buffer(identity.data(), identity.size()), reply_body);
+        REQUIRE(sent);
+        CHECK(*sent == 4u);
+
+        std::vector<zmq::message_t> reply;
+        REQUIRE(zmq::recv_multipart(dealer, std::back_inserter(reply)));
+        REQUIRE(reply.size() == 3u);
+        CHECK(reply[0].size() == 0u);
+        CHECK(reply[1].to_string() == "x");
+        CHECK(reply[2].to_string() == "yz");
+    }
+
+    SECTION("too many body parts are discarded")
+    {
+        std::array<zmq::const_buffer, 4> request = {
+          zmq::const_buffer(), zmq::str_buffer("1"), zmq::str_buffer("2"),
+          zmq::str_buffer("3")};
+        REQUIRE(zmq::send_multipart(dealer, request));
+        REQUIRE(zmq::send_multipart(dealer, request));
+
+        zmq::message_t identity;
+        std::array<zmq::message_t, 2> body;
+        CHECK_THROWS_AS(zmq::router_recv(router, identity, body.data(), body.size()),
+                        std::runtime_error);
+
+        // the next message is received from its start
+        std::array<zmq::message_t, 3> all;
+        const auto received =
+          zmq::router_recv(router, identity, all.data(), all.size());
+        REQUIRE(received);
+        CHECK(*received == 3u);
+        CHECK(identity.to_string() == "client");
+        CHECK(all[0].to_string() == "1");
+    }
+
+    SECTION("nothing pending")
+    {
+        zmq::message_t identity;
+        zmq::message_t body;
+        CHECK_FALSE(
+          zmq::router_recv(router, identity, body, zmq::recv_flags::dontwait));
+    }
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <map>
+#include <random>
+#include <string>
+
+TEST_CASE("routing_id construct", "[routing_table]")
+{
+    const zmq::routing_id empty;
+    CHECK(empty.empty());
+    CHECK(empty.size() == 0u);
+
+    const zmq::message_t msg(std::string("\0abc", 4));
+    const zmq::routing_id id(msg);
+    CHECK(id.size() == 4u);
+    CHECK(id.to_string() == std::string("\0abc", 4));
+    CHECK(id.equals(zmq::buffer(std::string("\0abc", 4))));
+    CHECK_FALSE(id.equals(zmq::str_buffer("abc")));
+    CHECK(id == zmq::routing_id(zmq::buffer(std::string("\0abc", 4))));
+    CHECK(id != empty);
+
+    const std::string longest(zmq::routing_id::max_size, 'x');
+    CHECK(zmq::routing_id(zmq::buffer(longest)).size() == longest.size());
+    CHECK_THROWS_AS(zmq::routing_id(zmq::buffer(longest + "x")), std::length_error);
+}
+
+TEST_CASE("routing_table insert and find", "[routing_table]")
+{
+    zmq::routing_table<int> table;
+    CHECK(table.empty());
+    CHECK(table.find(zmq::str_buffer("a")) == nullptr);
+
+    const auto inserted = table.emplace(zmq::str_buffer("a"), 1);
+    CHECK(inserted.second);
+    CHECK(*inserted.first == 1);
+    const auto again = table.emplace(zmq::str_buffer("a"), 2);
+    CHECK_FALSE(again.second);
+    CHECK(*again.first == 1);
+
+    table[zmq::str_buffer("b")] = 2;
+    ++table[zmq::str_buffer("b")];
+    CHECK(table.size() == 2u);
+    CHECK(*table.find(zmq::str_buffer("b")) == 3);
+
+    const zmq::message_t id(std::string("a"));
+    REQUIRE(table.find(id) != nullptr);
+    CHECK(*table.find(id) == 1);
+    CHECK(table.contains(zmq::str_buffer("a")));
+    CHECK_FALSE(table.contains(zmq::str_buffer("c")));
+    CHECK(table.find(zmq::buffer(std::string(300, 'x'))) == nullptr);
+    CHECK_THROWS_AS(table.emplace(zmq::buffer(std::string(300, 'x')), 0),
+                    std::length_error);
+
+    int sum = 0;
+    for (const auto &entry : table)
+        sum += entry.second;
+    CHECK(sum == 4);
+}
+
+TEST_CASE("routing_table erase", "[routing_table]")
+{
+    zmq::routing_table<std::string> table;
+    table.emplace(zmq::str_buffer("a"), "A");
+    table.emplace(zmq::str_buffer("b"), "B");
+    table.emplace(zmq::str_buffer("c"), "C");
+
+    CHECK(table.erase(zmq::str_buffer("a")));
+    CHECK_FALSE(table.erase(zmq::str_buffer("a")));
+    CHECK(table.size() == 2u);
+    CHECK(table.find(zmq::str_buffer("a")) == nullptr);
+    CHECK(*table.find(zmq::str_buffer("b")) == "B");
+    CHECK(*table.find(zmq::str_buffer("c")) == "C");
+
+    table.clear();
+    CHECK(table.empty());
+    CHECK(table.find(zmq::str_buffer("b")) == nullptr);
+    table[zmq::str_buffer("b")] = "B2";
+    CHECK(*table.find(zmq::str_buffer("b")) == "B2");
+}
+
+TEST_CASE("routing_table matches std::map", "[routing_table]")
+{
+    // random inserts and erases over a small key space, so that probe
+    // sequences collide, wrap around and are shifted back on erase
+    zmq::routing_table<int> table;
+    std::map<std::string, int> expected;
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20000; ++i) {
+        const std::string key = "peer-" + std::to_string(rng() % 500);
+        if (rng() % 3 == 0) {
+            CHECK(table.erase(zmq::buffer(key)) == (expected.erase(key) == 1));
+        } else {
+            table[zmq::buffer(key)] = i;
+            expected[key] = i;
+        }
+    }
+    REQUIRE(table.size() == expected.size());
+    for (const auto &entry : expected) {
+        const int *value = table.find(zmq::buffer(entry.first));
+        REQUIRE(value != nullptr);
+        CHECK(*value == entry.second);
+    }
+    for (const auto &entry : table)
+        CHECK(expected.at(entry.first.to_string()) == entry.second);
+}
+
+#endif
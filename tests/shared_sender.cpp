@@ -0,0 +1,88 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::shared_sender>::value,
+              "shared_sender should not be copy-constructible");
+
+TEST_CASE("shared_sender reports backpressure", "[shared_sender]")
+{
+    zmq::context_t context;
+    zmq::socket_t push(context, zmq::socket_type::push);
+    zmq::socket_t pull(context, zmq::socket_type::pull);
+    pull.bind("inproc://shared_sender_backpressure");
+    push.connect("inproc://shared_sender_backpressure");
+
+    zmq::shared_sender sender(push, 4);
+    CHECK(sender.capacity() == 4u);
+    for (int i = 0; i < 4; ++i)
+        CHECK(sender.try_send(zmq::message_t(&i, sizeof(i))));
+    zmq::message_t rejected(std::string("full"));
+    CHECK(!sender.try_send(std::move(rejected)));
+    CHECK(rejected.to_string() == "full"); // left untouched
+    CHECK(sender.rejected() == 1u);
+    CHECK(sender.size() == 4u);
+
+    CHECK(sender.wait(std::chrono::milliseconds{0}));
+    CHECK(sender.flush() == 4u);
+    CHECK(sender.sent() == 4u);
+    CHECK(sender.size() == 0u);
+    CHECK(!sender.wait(std::chrono::milliseconds{1}));
+
+    zmq::message_t msg;
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(pull.recv(msg, zmq::recv_flags::dontwait));
+        CHECK(*msg.data<int>() == i); // single producer keeps its order
+    }
+}
+
+TEST_CASE("shared_sender many producers", "[shared_sender]")
+{
+    zmq::context_t context;
+    zmq::socket_t push(context, zmq::socket_type::push);
+    zmq::socket_t pull(context, zmq::socket_type::pull);
+    pull.bind("inproc://shared_sender_producers");
+    push.connect("inproc://shared_sender_producers");
+
+    const int producers = 4;
+    const int messages = 1000;
+    zmq::shared_sender sender(push, 64);
+    std::atomic<int> done{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; ++t) {
+        threads.emplace_back([&sender, &done, t] {
+            for (int i = 0; i < messages; ++i) {
+                zmq::message_t msg(&t, sizeof(t));
+                while (!sender.try_send(std::move(msg)))
+                    std::this_thread::yield();
+            }
+            ++done;
+        });
+    }
+
+    // the owner drains pull as it goes, otherwise the pipe fills up and
+    // flush can no longer make progress
+    std::vector<int> received(producers, 0);
+    zmq::message_t msg;
+    while (done < producers || sender.size() > 0) {
+        sender.wait(std::chrono::milliseconds{10});
+        sender.flush();
+        while (pull.recv(msg, zmq::recv_flags::dontwait))
+            ++received[static_cast<size_t>(*msg.data<int>())];
+    }
+    for (auto &thread : threads)
+        thread.join();
+    CHECK(sender.sent() == static_cast<size_t>(producers * messages));
+
+    while (pull.recv(msg, zmq::recv_flags::dontwait))
+        ++received[static_cast<size_t>(*msg.data<int>())];
+    for (const int count : received)
+        CHECK(count == messages);
+}
+
+#endif
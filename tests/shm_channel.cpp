@@ -0,0 +1,144 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#if defined(ZMQ_CPP11) && CPPZMQ_HAS_MMAP && defined(MFD_CLOEXEC)
+
+#include <cstring>
+#include <string>
+
+static_assert(!std::is_copy_constructible<zmq::shm_channel>::value,
+              "shm_channel should not be copy-constructible");
+
+namespace
+{
+struct channel_fixture
+{
+    explicit channel_fixture(size_t capacity) :
+        producer_socket(context, zmq::socket_type::pair),
+        consumer_socket(context, zmq::socket_type::pair),
+        producer(producer_socket, capacity),
+        consumer(consumer_socket, producer.path())
+    {
+        producer_socket.bind("inproc://shm_channel");
+        consumer_socket.connect("inproc://shm_channel");
+    }
+
+    zmq::context_t context;
+    zmq::socket_t producer_socket;
+    zmq::socket_t consumer_socket;
+    zmq::shm_channel producer;
+    zmq::shm_channel consumer;
+};
+}
+
+TEST_CASE("shm_channel passes payloads through shared memory", "[shm_channel]")
+{
+    channel_fixture f(4096);
+    CHECK(f.producer.capacity() == 4096u);
+    CHECK(f.consumer.capacity() == 4096u);
+    CHECK(f.producer.fd() >= 0);
+
+    auto sent = f.producer.send(zmq::str_buffer("hello"));
+    REQUIRE(sent);
+    CHECK(*sent == 5u);
+    sent = f.producer.send(zmq::const_buffer());
+    REQUIRE(sent);
+    CHECK(*sent == 0u);
+
+    zmq::message_t msg;
+    auto received = f.consumer.recv(msg);
+    REQUIRE(received);
+    CHECK(*received == 5u);
+    CHECK(msg.to_string() == "hello");
+    received = f.consumer.recv(msg);
+    REQUIRE(received);
+    CHECK(*received == 0u);
+    CHECK(msg.size() == 0u);
+}
+
+TEST_CASE("shm_channel receives in place", "[shm_channel]")
+{
+    channel_fixture f(4096);
+    const zmq::mutable_buffer space = f.producer.reserve(3);
+    REQUIRE(space.data() != nullptr);
+    std::memcpy(space.data(), "abc", 3);
+    const auto committed = f.producer.commit();
+    REQUIRE(committed);
+    CHECK(*committed == 3u);
+
+    zmq::message_t msg;
+    REQUIRE(f.consumer.recv(msg));
+    CHECK(msg.to_string() == "abc");
+    // the consumer's mapping differs from the producer's, compare offsets
+    const zmq::mutable_buffer second = f.producer.reserve(1);
+    REQUIRE(second.data() != nullptr);
+    CHECK(static_cast<char *>(second.data()) - static_cast<char *>(space.data())
+          == 3);
+}
+
+TEST_CASE("shm_channel commits a reservation once", "[shm_channel]")
+{
+    channel_fixture f(4096);
+    CHECK_THROWS_AS(f.producer.commit(), std::runtime_error);
+
+    const zmq::mutable_buffer space = f.producer.reserve(2);
+    REQUIRE(space.data() != nullptr);
+    std::memcpy(space.data(), "ab", 2);
+    CHECK(f.producer.commit());
+    CHECK_THROWS_AS(f.producer.commit(), std::runtime_error);
+    CHECK(f.producer.send(zmq::str_buffer("cd")));
+
+    zmq::message_t first, second, third;
+    REQUIRE(f.consumer.recv(first));
+    REQUIRE(f.consumer.recv(second));
+    CHECK(first.to_string() == "ab");
+    CHECK(second.to_string() == "cd");
+    CHECK(!f.consumer.recv(third, zmq::recv_flags::dontwait));
+}
+
+TEST_CASE("shm_channel reuses space once messages are closed", "[shm_channel]")
+{
+    channel_fixture f(1000);
+    const std::string payload(400, 'p');
+
+    CHECK(f.producer.send(zmq::buffer(payload)));
+    CHECK(f.producer.send(zmq::buffer(payload)));
+    CHECK(!f.producer.send(zmq::buffer(payload))); // full
+
+    zmq::message_t first, second;
+    REQUIRE(f.consumer.recv(first));
+    REQUIRE(f.consumer.recv(second));
+
+    // released out of order, the space is reused in order
+    second = zmq::message_t();
+    CHECK(!f.producer.send(zmq::buffer(payload)));
+    first = zmq::message_t();
+    CHECK(f.producer.send(zmq::buffer(payload))); // wraps around
+
+    zmq::message_t third;
+    REQUIRE(f.consumer.recv(third));
+    CHECK(third.to_string() == payload);
+
+    CHECK_THROWS_AS(f.producer.reserve(1001), std::length_error);
+}
+
+TEST_CASE("shm_channel messages outlive the channel", "[shm_channel]")
+{
+    zmq::message_t msg;
+    {
+        channel_fixture f(256);
+        f.producer.send(zmq::str_buffer("survivor"));
+        REQUIRE(f.consumer.recv(msg));
+    }
+    CHECK(msg.to_string() == "survivor");
+}
+
+TEST_CASE("shm_channel attach fails for invalid paths", "[shm_channel]")
+{
+    zmq::context_t context;
+    zmq::socket_t socket(context, zmq::socket_type::pair);
+    CHECK_THROWS_AS(zmq::shm_channel(socket, std::string("/nonexistent/shm")),
+                    zmq::error_t);
+    CHECK_THROWS_AS(zmq::shm_channel(socket, size_t(0)), std::invalid_argument);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+TEST_CASE("socket_options default constructed", "[socket_options]")
+{
+    const zmq::socket_options opts;
+    CHECK(opts.empty());
+    CHECK(opts.size() == 0);
+}
+
+TEST_CASE("socket_options apply", "[socket_options]")
+{
+    zmq::context_t context;
+    zmq::socket_options opts;
+    opts.set(zmq::sockopt::linger, 17)
+      .set(zmq::sockopt::immediate, true)
+      .set(zmq::sockopt::routing_id, "foo");
+    CHECK(opts.size() == 3);
+
+    zmq::socket_t socket(context, zmq::socket_type::dealer);
+    opts.apply(socket);
+    CHECK(socket.get(zmq::sockopt::linger) == 17);
+    CHECK(socket.get(zmq::sockopt::immediate) == 1);
+    CHECK(socket.get(zmq::sockopt::routing_id) == "foo");
+
+    opts.clear();
+    CHECK(opts.empty());
+}
+
+TEST_CASE("socket_options apply_all", "[socket_options]")
+{
+    zmq::context_t context;
+    zmq::socket_options opts;
+    opts.set(zmq::sockopt::linger, 0).set(zmq::sockopt::sndhwm, 123);
+
+    std::vector<zmq::socket_t> sockets;
+    for (int i = 0; i < 4; ++i)
+        sockets.emplace_back(context, zmq::socket_type::push);
+    opts.apply_all(sockets);
+    for (auto &s : sockets) {
+        CHECK(s.get(zmq::sockopt::linger) == 0);
+        CHECK(s.get(zmq::sockopt::sndhwm) == 123);
+    }
+}
+
+TEST_CASE("socket_options apply invalid socket", "[socket_options]")
+{
+    zmq::socket_options opts;
+    opts.set(zmq::sockopt::linger, 0);
+    CHECK_THROWS_AS(opts.apply(zmq::socket_ref()), zmq::error_t);
+}
+
+TEST_CASE("socket_info", "[socket_options]")
+{
+    zmq::context_t context;
+    zmq::socket_t socket(context, zmq::socket_type::router);
+    const zmq::socket_info info(socket);
+    CHECK(info.type() == zmq::socket_type::router);
+    CHECK(info.socket() == socket);
+#ifdef ZMQ_THREAD_SAFE
+    CHECK_FALSE(info.thread_safe());
+#endif
+}
+
+TEST_CASE("context presets", "[socket_options]")
+{
+    for (const auto preset :
+         {zmq::context_preset::low_latency, zmq::context_preset::high_throughput,
+          zmq::context_preset::many_connections}) {
+        zmq::context_t context = zmq::make_context(preset);
+        CHECK(context.get(zmq::ctxopt::io_threads) >= 1);
+
+        const zmq::socket_options options = zmq::make_socket_options(preset);
+        CHECK(!options.empty());
+        zmq::socket_t socket(context, zmq::socket_type::dealer);
+        CHECK_NOTHROW(options.apply(socket));
+    }
+}
+
+TEST_CASE("context preset socket options", "[socket_options]")
+{
+    zmq::context_t context = zmq::make_context(zmq::context_preset::low_latency);
+    zmq::socket_t socket(context, zmq::socket_type::dealer);
+    zmq::make_socket_options(zmq::context_preset::low_latency).apply(socket);
+    CHECK(socket.get(zmq::sockopt::linger) == 0);
+    CHECK(socket.get(zmq::sockopt::immediate) == true);
+
+    zmq::make_socket_options(zmq::context_preset::many_connections).apply(socket);
+    CHECK(socket.get(zmq::sockopt::sndhwm) == 100);
+    CHECK(socket.get(zmq::sockopt::tcp_keepalive) == 1);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+static_assert(!std::is_copy_constructible<zmq::socket_pool>::value,
+              "socket_pool should not be copy-constructible");
+
+TEST_CASE("socket_pool acquire creates configured sockets", "[socket_pool]")
+{
+    zmq::context_t context;
+    zmq::socket_options opts;
+    opts.set(zmq::sockopt::linger, 0);
+    zmq::socket_pool pool(context, zmq::socket_type::dealer, opts);
+    CHECK(pool.idle() == 0);
+    CHECK(pool.type() == zmq::socket_type::dealer);
+
+    zmq::socket_t s = pool.acquire();
+    REQUIRE(s);
+    CHECK(s.get(zmq::sockopt::socket_type) == zmq::socket_type::dealer);
+    CHECK(s.get(zmq::sockopt::linger) == 0);
+    CHECK(pool.stats().misses == 1);
+    CHECK(pool.stats().hits == 0);
+}
+
+TEST_CASE("socket_pool warm up", "[socket_pool]")
+{
+    zmq::context_t context;
+    zmq::socket_pool pool(context, zmq::socket_type::dealer, {}, 2);
+    pool.warm_up(3);
+    CHECK(pool.idle() == 2);
+
+    zmq::socket_t s1 = pool.acquire();
+    zmq::socket_t s2 = pool.acquire();
+    zmq::socket_t s3 = pool.acquire();
+    CHECK(s1);
+    CHECK(s3);
+    CHECK(pool.idle() == 0);
+    CHECK(pool.stats().hits == 2);
+    CHECK(pool.stats().misses == 1);
+
+    pool.warm_up(1);
+    CHECK(pool.idle() == 1);
+    pool.clear();
+    CHECK(pool.idle() == 0);
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef ZMQ_CPP11
+
+static_assert(std::is_default_constructible<zmq::timer_wheel>::value, "");
+static_assert(!std::is_copy_constructible<zmq::timer_wheel>::value, "");
+static_assert(!std::is_copy_assignable<zmq::timer_wheel>::value, "");
+
+TEST_CASE("timer_wheel constructor", "[timer_wheel]")
+{
+    zmq::timer_wheel wheel;
+    CHECK(wheel.empty());
+    CHECK(wheel.resolution() == std::chrono::microseconds{1});
+    CHECK(!wheel.timeout().has_value());
+    CHECK_THROWS_AS(zmq::timer_wheel(std::chrono::microseconds{0}),
+                    std::invalid_argument);
+}
+
+TEST_CASE("timer_wheel add/execute", "[timer_wheel]")
+{
+    using namespace std::chrono_literals;
+    zmq::timer_wheel wheel;
+    int runs = 0;
+    zmq::timer_wheel::id_t fired = 0;
+    const auto id = wheel.add(4ms, [&](zmq::timer_wheel::id_t timer_id) {
+        ++runs;
+        fired = timer_id;
+    });
+    CHECK(wheel.size() == 1u);
+    REQUIRE(wheel.timeout().has_value());
+    CHECK(*wheel.timeout() <= 4ms);
+    wheel.execute();
+    CHECK(runs == 0);
+
+    std::this_thread::sleep_for(10ms);
+    wheel.execute();
+    CHECK(runs == 1);
+    CHECK(fired == id);
+
+    // timers repeat until cancelled
+    std::this_thread::sleep_for(10ms);
+    wheel.execute();
+    CHECK(runs == 2);
+    CHECK(wheel.size() == 1u);
+}
+
+TEST_CASE("timer_wheel add/cancel", "[timer_wheel]")
+{
+    using namespace std::chrono_literals;
+    zmq::timer_wheel wheel;
+    bool handler_ran = false;
+    const auto id =
+      wheel.add(4ms, [&](zmq::timer_wheel::id_t) { handler_ran = true; });
+    CHECK(wheel.timeout().has_value());
+    wheel.cancel(id);
+    CHECK(wheel.empty());
+    CHECK(!wheel.timeout().has_value());
+    std::this_thread::sleep_for(10ms);
+    wheel.execute();
+    CHECK(!handler_ran);
+
+    CHECK_THROWS_AS(wheel.cancel(id), zmq::error_t);
+    // a recycled slot does not revive a cancelled id
+    wheel.add(4ms, [](zmq::timer_wheel::id_t) {});
+    CHECK_THROWS_AS(wheel.reset(id), zmq::error_t);
+}
+
+TEST_CASE("timer_wheel set_interval", "[timer_wheel]")
+{
+    using namespace std::chrono_literals;
+    zmq::timer_wheel wheel;
+    bool handler_ran = false;
+    // beyond the range of the wheel itself, parked in overflow
+    const auto id =
+      wheel.add(4h, [&](zmq::timer_wheel::id_t) { handler_ran = true; });
+    REQUIRE(wheel.timeout().has_value());
+    CHECK(*wheel.timeout() > 1h);
+    wheel.set_interval(id, 4ms);
+    CHECK(*wheel.timeout() <= 4ms);
+    std::this_thread::sleep_for(10ms);
+    wheel.execute();
+    CHECK(handler_ran);
+}
+
+TEST_CASE("timer_wheel reset", "[timer_wheel]")
+{
+    using namespace std::chrono_literals;
+    zmq::timer_wheel wheel;
+    bool handler_ran = false;
+    const auto id =
+      wheel.add(50ms, [&](zmq::timer_wheel::id_t) { handler_ran = true; });
+    std::this_thread::sleep_for(25ms);
+    wheel.reset(id);
+    std::this_thread::sleep_for(30ms);
+    wheel.execute();
+    CHECK(!handler_ran);
+    std::this_thread::sleep_for(30ms);
+    wheel.execute();
+    CHECK(handler_ran);
+}
+
+TEST_CASE("timer_wheel handler cancels itself", "[timer_wheel]")
+{
+    using namespace std::chrono_literals;
+    zmq::timer_wheel wheel;
+    int runs = 0;
+    wheel.add(1ms, [&](zmq::timer_wheel::id_t id) {
+        ++runs;
+        wheel.cancel(id);
+        wheel.add(1ms, [](zmq::timer_wheel::id_t) {});
+    });
+    std::this_thread::sleep_for(5ms);
+    wheel.execute();
+    std::this_thread::sleep_for(5ms);
+    wheel.execute();
+    CHECK(runs == 1);
+    CHECK(wheel.size() == 1u);
+}
+
+TEST_CASE("timer_wheel many timers", "[timer_wheel]")
+{
+    using namespace std::chrono_literals;
+    zmq::timer_wheel wheel;
+    std::vector<int> runs(1000, 0);
+    std::vector<zmq::timer_wheel::id_t> ids;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        // spread over several levels, from 1us to ~10ms
+        const auto interval = std::chrono::microseconds{1 + i * 10};
+        ids.push_back(
+          wheel.add(interval, [&runs, i](zmq::timer_wheel::id_t) { ++runs[i]; }));
+    }
+    for (size_t i = 0; i < ids.size(); i += 2)
+        wheel.cancel(ids[i]);
+    CHECK(wheel.size() == 500u);
+
+    std::this_thread::sleep_for(15ms);
+    wheel.execute();
+    for (size_t i = 0; i < runs.size(); ++i)
+        CHECK(runs[i] == (i % 2 ? 1 : 0));
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include <catch2/catch_all.hpp>
+#include <zmq_addon.hpp>
+#ifdef ZMQ_CPP11
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<zmq::topic_dispatcher>::value,
+              "topic_dispatcher should not be copy-constructible");
+
+namespace
+{
+std::vector<zmq::message_t> make_parts(const std::string &topic)
+{
+    std::vector<zmq::message_t> parts;
+    parts.emplace_back(topic);
+    parts.emplace_back(std::string("payload"));
+    return parts;
+}
+}
+
+TEST_CASE("topic_dispatcher picks the longest matching prefix",
+          "[topic_dispatcher]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    zmq::topic_dispatcher dispatcher(sub);
+    CHECK(dispatcher.empty());
+
+    std::string last;
+    dispatcher.subscribe("a", [&](std::vector<zmq::message_t> &) { last = "a"; });
+    dispatcher.subscribe("abc",
+                         [&](std::vector<zmq::message_t> &) { last = "abc"; });
+    dispatcher.subscribe(zmq::str_buffer("b"),
+                         [&](std::vector<zmq::message_t> &) { last = "b"; });
+    CHECK(dispatcher.size() == 3u);
+
+    auto parts = make_parts("abcd");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(last == "abc");
+    parts = make_parts("ab");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(last == "a");
+    parts = make_parts("bz");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(last == "b");
+
+    parts = make_parts("c");
+    CHECK(!dispatcher.dispatch(parts));
+    CHECK(dispatcher.unmatched() == 1u);
+    CHECK(dispatcher.find(zmq::str_buffer("")) == nullptr);
+
+    std::vector<zmq::message_t> none;
+    CHECK(!dispatcher.dispatch(none));
+}
+
+TEST_CASE("topic_dispatcher resubscribe replaces the handler",
+          "[topic_dispatcher]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    zmq::topic_dispatcher dispatcher(sub);
+
+    int calls = 0;
+    dispatcher.subscribe("t", [&](std::vector<zmq::message_t> &) { calls += 1; });
+    dispatcher.subscribe("t", [&](std::vector<zmq::message_t> &) { calls += 10; });
+    CHECK(dispatcher.size() == 1u);
+
+    auto parts = make_parts("topic");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(calls == 10);
+
+    CHECK_THROWS_AS(dispatcher.subscribe("t", nullptr), std::invalid_argument);
+}
+
+TEST_CASE("topic_dispatcher unsubscribe prunes the index", "[topic_dispatcher]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    zmq::topic_dispatcher dispatcher(sub);
+
+    std::string last;
+    dispatcher.subscribe("", [&](std::vector<zmq::message_t> &) { last = "all"; });
+    dispatcher.subscribe("news.sport",
+                         [&](std::vector<zmq::message_t> &) { last = "sport"; });
+
+    auto parts = make_parts("news.sport.f1");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(last == "sport");
+
+    CHECK(!dispatcher.unsubscribe("news"));
+    CHECK(dispatcher.unsubscribe("news.sport"));
+    CHECK(!dispatcher.unsubscribe("news.sport"));
+    CHECK(dispatcher.size() == 1u);
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(last == "all");
+
+    dispatcher.subscribe("news.weather",
+                         [&](std::vector<zmq::message_t> &) { last = "weather"; });
+    parts = make_parts("news.weather");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(last == "weather");
+
+    CHECK(dispatcher.unsubscribe(""));
+    CHECK(dispatcher.unsubscribe("news.weather"));
+    CHECK(dispatcher.empty());
+    CHECK(!dispatcher.dispatch(parts));
+}
+
+TEST_CASE("topic_dispatcher handlers change subscriptions while running",
+          "[topic_dispatcher]")
+{
+    zmq::context_t context;
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    zmq::topic_dispatcher dispatcher(sub);
+
+    // the captured string is destroyed with the handler, so using it after
+    // replacing the handler would read freed memory
+    std::vector<std::string> calls;
+    const std::string first(64, '1');
+    dispatcher.subscribe("t", [&, first](std::vector<zmq::message_t> &) {
+        dispatcher.subscribe("t", [&](std::vector<zmq::message_t> &) {
+            calls.push_back("second");
+        });
+        for (int i = 0; i < 16; ++i)
+            dispatcher.subscribe("t" + std::to_string(i),
+                                 [](std::vector<zmq::message_t> &) {});
+        calls.push_back(first);
+    });
+    dispatcher.subscribe("u", [&, first](std::vector<zmq::message_t> &) {
+        CHECK(dispatcher.unsubscribe("u"));
+        calls.push_back(first);
+    });
+
+    auto parts = make_parts("t");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(dispatcher.dispatch(parts));
+    parts = make_parts("u");
+    CHECK(dispatcher.dispatch(parts));
+    CHECK(!dispatcher.dispatch(parts));
+
+    REQUIRE(calls.size() == 3u);
+    CHECK(calls[0] == first);
+    CHECK(calls[1] == "second");
+    CHECK(calls[2] == first);
+    CHECK(dispatcher.size() == 17u);
+}
+
+TEST_CASE("topic_dispatcher receives and dispatches", "[topic_dispatcher]")
+{
+    zmq::context_t context;
+    zmq::socket_t pub(context, zmq::socket_type::pub);
+    zmq::socket_t sub(context, zmq::socket_type::sub);
+    pub.bind("inproc://topic_dispatcher");
+    sub.connect("inproc://topic_dispatcher");
+
+    zmq::topic_dispatcher dispatcher(sub);
+    std::vector<std::string> received;
+    dispatcher.subscribe("A", [&](std::vector<zmq::message_t> &parts) {
+        REQUIRE(parts.size() == 2u);
+        received.push_back(parts[1].to_string());
+    });
+
+    // subscriptions propagate asynchronously, keep publishing until one arrives
+    for (int i = 0; i < 1000 && received.empty(); ++i) {
+        std::array<zmq::const_buffer, 2> msg = {zmq::str_buffer("A1"),
+                                                zmq::str_buffer("first")};
+        zmq::send_multipart(pub, msg);
+        dispatcher.recv(zmq::recv_flags::dontwait);
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    REQUIRE(!received.empty());
+    CHECK(received.front() == "first");
+    CHECK(dispatcher.unmatched() == 0u);
+}
+
+#endif
@@ -131,6 +131,7 @@
 #include <chrono>
 #include <tuple>
 #include <memory>
+#include <new>
 #endif
 
 #if defined(__has_include) && defined(ZMQ_CPP17)
@@ -157,6 +158,17 @@
 #include <string_view>
 #endif
 
+#if !defined(CPPZMQ_HAS_SSE2)                                                       \
+  && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)                     \
+      || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CPPZMQ_HAS_SSE2 1
+#endif
+#ifndef CPPZMQ_HAS_SSE2
+#define CPPZMQ_HAS_SSE2 0
+#elif CPPZMQ_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
 /*  Version macros for compile-time API version detection                     */
 #define CPPZMQ_VERSION_MAJOR 4
 #define CPPZMQ_VERSION_MINOR 11
@@ -423,6 +435,181 @@ template<class T> struct is_char_type
 
 #endif
 
+namespace detail
+{
+// Sinks for the debug dumps of messages, see message_t::str.
+class string_sink
+{
+  public:
+    explicit string_sink(std::string &s) : _s(s), _reserved_at(0) {}
+    void append(const char *data, size_t size) { _s.append(data, size); }
+
+    // Space for up to size characters, of which commit() keeps used.
+    char *reserve(size_t size)
+    {
+        _reserved_at = _s.size();
+        _s.resize(_reserved_at + size);
+        return &_s[_reserved_at];
+    }
+    void commit(size_t used) { _s.resize(_reserved_at + used); }
+
+  private:
+    std::string &_s;
+    size_t _reserved_at;
+};
+
+// Fills a fixed buffer, counting what does not fit.
+class buffer_sink
+{
+  public:
+    buffer_sink(char *buf, size_t capacity) :
+        _buf(buf), _capacity(capacity), _size(0)
+    {
+    }
+
+    void append(const char *data, size_t size)
+    {
+        if (_size < _capacity)
+            memcpy(_buf + _size, data, std::min(size, _capacity - _size));
+        _size += size;
+    }
+
+    // Space for up to size characters, null if they might not fit.
+    char *reserve(size_t size)
+    {
+        return size <= _capacity - std::min(_size, _capacity) ? _buf + _size
+                                                               : ZMQ_NULLPTR;
+    }
+    void commit(size_t used) { _size += used; }
+
+    // NUL-terminate within the buffer, returning the untruncated length
+    size_t finish()
+    {
+        if (_capacity > 0)
+            _buf[std::min(_size, _capacity - 1)] = '\0';
+        return _size;
+    }
+
+  private:
+    char *_buf;
+    size_t _capacity;
+    size_t _size;
+};
+
+// Decimal with at least three digits, as setw(3) << setfill('0').
+template<class Sink> void dump_size(Sink &sink, size_t value)
+{
+    char digits[24];
+    size_t i = sizeof(digits);
+    do {
+        digits[--i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (sizeof(digits) - i < 3)
+        digits[--i] = '0';
+    sink.append(digits + i, sizeof(digits) - i);
+}
+
+// How each byte appears in a dump: printable bytes as they are if
+// text is set, all others as two hex digits.
+struct dump_table
+{
+    dump_table(bool text, bool upper)
+    {
+        const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        for (size_t i = 0; i < 256; ++i) {
+            const unsigned char byte = static_cast<unsigned char>(i);
+            if (text && is_printable(byte)) {
+                chars[i][0] = static_cast<char>(byte);
+                chars[i][1] = 0;
+                width[i] = 1;
+            } else {
+                chars[i][0] = digits[byte >> 4];
+                chars[i][1] = digits[byte & 0xf];
+                width[i] = 2;
+            }
+        }
+    }
+
+    static bool is_printable(unsigned char c) { return c >= 32 && c < 127; }
+
+    char chars[256][2];
+    unsigned char width[256];
+};
+
+// Printable bytes as they are, the others as hex, with a space between
+// printable and other bytes. Writes at most three characters per byte,
+// without branching on the content, and returns the number written.
+inline size_t dump_bytes(char *out,
+                         const unsigned char *data,
+                         size_t size,
+                         unsigned char &last_width)
+{
+    static const dump_table table(true, true);
+    size_t used = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const unsigned char byte = data[i];
+        const unsigned char width = table.width[byte];
+        out[used] = ' ';
+        used += width != last_width;
+        out[used] = table.chars[byte][0];
+        out[used + 1] = table.chars[byte][1];
+        used += width;
+        last_width = width;
+    }
+    return used;
+}
+
+template<class Sink>
+void dump_message(Sink &sink,
+                  const unsigned char *data,
+                  size_t size,
+                  size_t max_size)
+{
+    static const char head[] = "zmq::message_t [size ";
+    static const char elided[] = "... too big to print)";
+    sink.append(head, sizeof(head) - 1);
+    dump_size(sink, size);
+    sink.append("] (", 3);
+
+    const size_t size_to_print = std::min(size, max_size);
+    // the first byte gets no space in front of it
+    unsigned char last_width =
+      size_to_print > 0 ? (dump_table::is_printable(data[0]) ? 1 : 2) : 0;
+    if (char *out = sink.reserve(3 * size_to_print)) {
+        sink.commit(dump_bytes(out, data, size_to_print, last_width));
+    } else {
+        // staged through a local buffer where the dump might not fit
+        char buf[3 * 64];
+        for (size_t i = 0; i < size_to_print; i += 64) {
+            const size_t count = std::min<size_t>(64, size_to_print - i);
+            sink.append(buf, dump_bytes(buf, data + i, count, last_width));
+        }
+    }
+
+    if (max_size < size)
+        sink.append(elided, sizeof(elided) - 1);
+    else
+        sink.append(")", 1);
+}
+
+#ifdef ZMQ_CPP11
+// Construct a T at p. Aggregates get brace initialization, as they have no
+// constructor taking the member values before C++20.
+template<class T, class... Args>
+T *construct_in_place(void *p, std::true_type, Args &&...args)
+{
+    return ::new (p) T(std::forward<Args>(args)...);
+}
+
+template<class T, class... Args>
+T *construct_in_place(void *p, std::false_type, Args &&...args)
+{
+    return ::new (p) T{std::forward<Args>(args)...};
+}
+#endif
+} // namespace detail
+
 class message_t
 {
   public:
@@ -629,6 +816,23 @@ class message_t
         return static_cast<T const *>(data());
     }
 
+#ifdef ZMQ_CPP11
+    // Rebuild the message with sizeof(T) bytes and construct a T in place, e.g.
+    // `auto &rec = msg.emplace<record>(id, value)`
+    // Throws std::runtime_error if the message data is not suitably aligned for T.
+    template<class T, class... Args> T &emplace(Args &&...args)
+    {
+        static_assert(ZMQ_IS_TRIVIALLY_COPYABLE(T) && std::is_standard_layout<T>::value,
+                      "T must be POD");
+        rebuild(sizeof(T));
+        if (reinterpret_cast<uintptr_t>(data()) % alignof(T) != 0)
+            throw std::runtime_error(
+              "Invalid type, message data is not suitably aligned");
+        return *detail::construct_in_place<T>(
+          data(), std::is_constructible<T, Args...>(), std::forward<Args>(args)...);
+    }
+#endif
+
     ZMQ_DEPRECATED("from 4.3.0, use operator== instead")
     bool equal(const message_t *other) const ZMQ_NOTHROW { return *this == *other; }
 
@@ -704,45 +908,37 @@ class message_t
 
     /** Dump content to string for debugging.
     *   Ascii chars are readable, the rest is printed as hex.
-    *   Probably ridiculously slow.
     *   Use to_string() or to_string_view() for
     *   interpreting the message as a string.
     */
     std::string str(size_t max_size = 1000) const
     {
-        // Partly mutuated from the same method in zmq::multipart_t
-        std::stringstream os;
-
-        const unsigned char *msg_data = this->data<unsigned char>();
-        size_t size_to_print = std::min(this->size(), max_size);
-        int is_ascii[2] = {0, 0};
-        // Set is_ascii for the first character
-        if (size_to_print > 0)
-            is_ascii[0] = (*msg_data >= 32 && *msg_data < 127);
-
-        os << "zmq::message_t [size " << std::dec << std::setw(3)
-           << std::setfill('0') << this->size() << "] (";
-        while (size_to_print--) {
-            const unsigned char byte = *msg_data++;
+        std::string out;
+        str(out, max_size);
+        return out;
+    }
 
-            is_ascii[1] = (byte >= 32 && byte < 127);
-            if (is_ascii[1] != is_ascii[0])
-                os << " "; // Separate text/non text
+    /** Dump content into out, replacing its contents. Reusing out
+    *   avoids allocating once its capacity suffices.
+    */
+    void str(std::string &out, size_t max_size = 1000) const
+    {
+        out.clear();
+        detail::string_sink sink(out);
+        detail::dump_message(sink, this->data<unsigned char>(), this->size(),
+                             max_size);
+    }
 
-            if (is_ascii[1]) {
-                os << byte;
-            } else {
-                os << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
-                   << static_cast<short>(byte);
-            }
-            is_ascii[0] = is_ascii[1];
-        }
-        // Elide the rest if the message is too large
-        if (max_size < this->size())
-            os << "... too big to print)";
-        else
-            os << ")";
-        return os.str();
+    /** Dump content into buf of buf_size bytes, always NUL-terminated
+    *   and cut short if it does not fit. Never allocates.
+    *   Returns the length of the whole dump, as snprintf does.
+    */
+    size_t str(char *buf, size_t buf_size, size_t max_size = 1000) const
+    {
+        detail::buffer_sink sink(buf, buf_size);
+        detail::dump_message(sink, this->data<unsigned char>(), this->size(),
+                             max_size);
+        return sink.finish();
     }
 
     void swap(message_t &other) ZMQ_NOTHROW
@@ -1399,6 +1595,313 @@ constexpr const_buffer operator""_zbuf(const char32_t *str, size_t len) noexcept
 }
 }
 
+namespace detail
+{
+// Hash primitives, loosely following the structure of XXH3: short inputs
+// are mixed directly, long inputs are folded into eight independent 64-bit
+// lanes using 32x32->64 multiplies, two lanes per SSE2 register if available.
+inline const uint64_t *hash_secret() ZMQ_NOTHROW
+{
+    // the first 16 outputs of splitmix64 seeded with 0
+    static const uint64_t secret[16] = {
+      0xe220a8397b1dcdafULL, 0x6e789e6aa1b965f4ULL, 0x06c45d188009454fULL,
+      0xf88bb8a8724c81ecULL, 0x1b39896a51a8749bULL, 0x53cb9f0c747ea2eaULL,
+      0x2c829abe1f4532e1ULL, 0xc584133ac916ab3cULL, 0x3ee5789041c98ac3ULL,
+      0xf3b8488c368cb0a6ULL, 0x657eecdd3cb13d09ULL, 0xc2d326e0055bdef6ULL,
+      0x8621a03fe0bbdb7bULL, 0x8e1f7555983aa92fULL, 0xb54e0f1600cc4d19ULL,
+      0x84bb3f97971d80abULL};
+    return secret;
+}
+
+ZMQ_CONSTEXPR_VAR uint64_t hash_prime32_1 = 0x9e3779b1ULL;
+ZMQ_CONSTEXPR_VAR uint64_t hash_prime64_1 = 0x9e3779b185ebca87ULL;
+ZMQ_CONSTEXPR_VAR uint64_t hash_prime64_2 = 0xc2b2ae3d27d4eb4fULL;
+
+inline uint64_t hash_read64(const unsigned char *p) ZMQ_NOTHROW
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+inline uint32_t hash_read32(const unsigned char *p) ZMQ_NOTHROW
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+inline uint64_t hash_rotl(uint64_t v, int n) ZMQ_NOTHROW
+{
+    return (v << n) | (v >> (64 - n));
+}
+
+// xor of the high and low halves of the 128-bit product
+inline uint64_t hash_fold(uint64_t a, uint64_t b) ZMQ_NOTHROW
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    const uint128 product = static_cast<uint128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    const uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+    const uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+    const uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+    const uint64_t hi_hi = (a >> 32) * (b >> 32);
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    const uint64_t lower = (cross << 32) | (lo_lo & 0xffffffff);
+    return lower ^ upper;
+#endif
+}
+
+inline uint64_t hash_avalanche(uint64_t h) ZMQ_NOTHROW
+{
+    h ^= h >> 37;
+    h *= 0x165667919e3779f9ULL;
+    return h ^ (h >> 32);
+}
+
+inline uint64_t hash_mix16(const unsigned char *p,
+                           const uint64_t *key,
+                           uint64_t seed) ZMQ_NOTHROW
+{
+    return hash_fold(hash_read64(p) ^ (key[0] + seed),
+                     hash_read64(p + 8) ^ (key[1] - seed));
+}
+
+inline uint64_t hash_short(const unsigned char *p, size_t n, uint64_t seed)
+  ZMQ_NOTHROW
+{
+    const uint64_t *key = hash_secret();
+    if (n > 8) {
+        const uint64_t lo = hash_read64(p) ^ (key[0] + seed);
+        const uint64_t hi = hash_read64(p + n - 8) ^ (key[1] - seed);
+        return hash_avalanche(n + hash_rotl(lo, 32) + hi + hash_fold(lo, hi));
+    }
+    if (n >= 4) {
+        const uint64_t combined =
+          hash_read32(p + n - 4) + (static_cast<uint64_t>(hash_read32(p)) << 32);
+        uint64_t h = combined ^ ((key[2] ^ key[3]) - seed);
+        h ^= hash_rotl(h, 49) ^ hash_rotl(h, 24);
+        h *= 0x9fb21c651e98df25ULL;
+        h ^= (h >> 35) + n;
+        h *= 0x9fb21c651e98df25ULL;
+        return h ^ (h >> 28);
+    }
+    if (n > 0) {
+        const uint64_t combined = (static_cast<uint64_t>(p[0]) << 16)
+                                  | (static_cast<uint64_t>(p[n >> 1]) << 24)
+                                  | p[n - 1] | (static_cast<uint64_t>(n) << 8);
+        return hash_avalanche((combined ^ ((key[4] >> 32) + seed)) * hash_prime64_1);
+    }
+    return hash_avalanche(seed ^ key[5] ^ key[6]);
+}
+
+inline uint64_t hash_medium(const unsigned char *p, size_t n, uint64_t seed)
+  ZMQ_NOTHROW
+{
+    const uint64_t *key = hash_secret();
+    uint64_t acc = n * hash_prime64_1;
+    if (n > 32) {
+        if (n > 64) {
+            if (n > 96) {
+                acc += hash_mix16(p + 48, key + 12, seed);
+                acc += hash_mix16(p + n - 64, key + 14, seed);
+            }
+            acc += hash_mix16(p + 32, key + 8, seed);
+            acc += hash_mix16(p + n - 48, key + 10, seed);
+        }
+        acc += hash_mix16(p + 16, key + 4, seed);
+        acc += hash_mix16(p + n - 32, key + 6, seed);
+    }
+    acc += hash_mix16(p, key, seed);
+    acc += hash_mix16(p + n - 16, key + 2, seed);
+    return hash_avalanche(acc);
+}
+
+// adds the given number of 64-byte stripes to the eight lanes, shifting the
+// key by one word per stripe
+inline void hash_accumulate(uint64_t *acc,
+                            const unsigned char *p,
+                            const uint64_t *key,
+                            size_t stripes) ZMQ_NOTHROW
+{
+#if CPPZMQ_HAS_SSE2
+    __m128i lanes[4];
+    for (size_t i = 0; i < 4; ++i)
+        lanes[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + 2 * i));
+    for (size_t s = 0; s < stripes; ++s, p += 64) {
+        for (size_t i = 0; i < 4; ++i) {
+            const __m128i v =
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+            const __m128i secret =
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + s + 2 * i));
+            const __m128i k = _mm_xor_si128(v, secret);
+            const __m128i product =
+              _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+            const __m128i swapped = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+            lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < 4; ++i)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + 2 * i), lanes[i]);
+#else
+    for (size_t s = 0; s < stripes; ++s, p += 64) {
+        for (size_t i = 0; i < 8; ++i) {
+            const uint64_t v = hash_read64(p + 8 * i);
+            const uint64_t k = v ^ key[s + i];
+            acc[i ^ 1] += v;
+            acc[i] += (k & 0xffffffff) * (k >> 32);
+        }
+    }
+#endif
+}
+
+inline uint64_t hash_long(const unsigned char *p, size_t n, uint64_t seed)
+  ZMQ_NOTHROW
+{
+    const size_t stripe = 64;
+    const size_t stripes_per_block = 8;
+    const unsigned char *const end = p + n;
+
+    uint64_t key[16];
+    for (size_t i = 0; i < 16; ++i)
+        key[i] = hash_secret()[i] + ((i & 1) ? 0 - seed : seed);
+
+    uint64_t acc[8] = {0xc2b2ae3dULL,         hash_prime64_1,
+                       hash_prime64_2,        0x165667b19e3779f9ULL,
+                       0x85ebca77c2b2ae63ULL, 0x85ebca77ULL,
+                       0x27d4eb2f165667c5ULL, hash_prime32_1};
+
+    // the last stripe is always taken from the end of the input
+    size_t stripes = (n - 1) / stripe;
+    for (; stripes >= stripes_per_block; stripes -= stripes_per_block) {
+        hash_accumulate(acc, p, key, stripes_per_block);
+        for (size_t i = 0; i < 8; ++i) {
+            acc[i] ^= acc[i] >> 47;
+            acc[i] ^= key[8 + i];
+            acc[i] *= hash_prime32_1;
+        }
+        p += stripe * stripes_per_block;
+    }
+    hash_accumulate(acc, p, key, stripes);
+    hash_accumulate(acc, end - stripe, key + 8, 1);
+
+    uint64_t result = n * hash_prime64_1;
+    for (size_t i = 0; i < 8; i += 2)
+        result += hash_fold(acc[i] ^ key[i + 1], acc[i + 1] ^ key[i + 7]);
+    return hash_avalanche(result);
+}
+} // namespace detail
+
+/*  Returns a fast, non-cryptographic 64-bit hash of the buffer content.
+
+    Equal content yields equal hashes for a given seed. The value is meant
+    for in-process containers and caches, it is not stable across cppzmq
+    versions or platforms and must not be persisted or sent to peers. A
+    per-process random seed makes hash flooding by remote peers harder.
+*/
+inline uint64_t hash(const_buffer buf, uint64_t seed = 0) ZMQ_NOTHROW
+{
+    const unsigned char *p = static_cast<const unsigned char *>(buf.data());
+    const size_t n = buf.size();
+    if (n <= 16)
+        return detail::hash_short(p, n, seed);
+    if (n <= 128)
+        return detail::hash_medium(p, n, seed);
+    return detail::hash_long(p, n, seed);
+}
+
+/*  Returns zmq::hash of the message content, consistent with
+    message_t::operator==. Message properties are not taken into account.
+*/
+inline uint64_t hash(const message_t &msg, uint64_t seed = 0) ZMQ_NOTHROW
+{
+    return hash(const_buffer(msg.data(), msg.size()), seed);
+}
+
+/*  A typed, read-only view of the content of a message or buffer.
+
+    message_view<T> refers to exactly one T, message_view<T[]> to a
+    contiguous array of T. Size and alignment are validated once on
+    construction, afterwards the content is accessed in place without
+    copying. The view does not own the data, i.e. the message or buffer
+    must outlive the view.
+*/
+template<class T> class message_view
+{
+    static_assert(detail::is_pod_like<T>::value, "T must be POD");
+
+  public:
+    using value_type = T;
+
+    explicit message_view(const message_t &msg) :
+        message_view(const_buffer(msg.data(), msg.size()))
+    {
+    }
+
+    explicit message_view(const_buffer buf) :
+        _ptr(static_cast<const T *>(buf.data()))
+    {
+        if (buf.size() != sizeof(T))
+            throw std::runtime_error(
+              "Invalid type, size does not match the message size");
+        if (reinterpret_cast<uintptr_t>(buf.data()) % alignof(T) != 0)
+            throw std::runtime_error(
+              "Invalid type, message data is not suitably aligned");
+    }
+
+    const T &get() const noexcept { return *_ptr; }
+    const T &operator*() const noexcept { return *_ptr; }
+    const T *operator->() const noexcept { return _ptr; }
+
+  private:
+    const T *_ptr;
+};
+
+template<class T> class message_view<T[]>
+{
+    static_assert(detail::is_pod_like<T>::value, "T must be POD");
+
+  public:
+    using value_type = T;
+    using const_iterator = const T *;
+
+    explicit message_view(const message_t &msg) :
+        message_view(const_buffer(msg.data(), msg.size()))
+    {
+    }
+
+    explicit message_view(const_buffer buf) :
+        _ptr(static_cast<const T *>(buf.data())), _size(buf.size() / sizeof(T))
+    {
+        if (buf.size() % sizeof(T) != 0)
+            throw std::runtime_error(
+              "Invalid type, size is not a multiple of the element size");
+        if (reinterpret_cast<uintptr_t>(buf.data()) % alignof(T) != 0)
+            throw std::runtime_error(
+              "Invalid type, message data is not suitably aligned");
+    }
+
+    const T *data() const noexcept { return _ptr; }
+    size_t size() const noexcept { return _size; }
+    ZMQ_NODISCARD bool empty() const noexcept { return _size == 0; }
+
+    const_iterator begin() const noexcept { return _ptr; }
+    const_iterator end() const noexcept { return _ptr + _size; }
+
+    const T &operator[](size_t i) const noexcept
+    {
+        assert(i < _size);
+        return _ptr[i];
+    }
+
+  private:
+    const T *_ptr;
+    size_t _size;
+};
+
 #ifdef ZMQ_CPP11
 enum class socket_type : int
 {
@@ -2236,6 +2739,14 @@ template<> struct hash<zmq::socket_ref>
         return hash<void *>()(sr.handle());
     }
 };
+
+template<> struct hash<zmq::message_t>
+{
+    size_t operator()(const zmq::message_t &msg) const ZMQ_NOTHROW
+    {
+        return static_cast<size_t>(zmq::hash(msg));
+    }
+};
 } // namespace std
 #endif
 
@@ -2754,6 +3265,7 @@ template<typename T = no_user_data> class poller_t
         if (0 != zmq_poller_remove(poller_ptr.get(), socket.handle())) {
             throw error_t();
         }
+        --item_count;
     }
 
     void remove(fd_t fd)
@@ -2761,6 +3273,7 @@ template<typename T = no_user_data> class poller_t
         if (0 != zmq_poller_remove_fd(poller_ptr.get(), fd)) {
             throw error_t();
         }
+        --item_count;
     }
 
     void modify(zmq::socket_ref socket, event_flags events)
@@ -2804,22 +3317,41 @@ template<typename T = no_user_data> class poller_t
     {
         static_assert(std::is_same<typename Sequence::value_type, event_type>::value,
                       "Sequence::value_type must be of poller_t::event_type");
-        int rc = zmq_poller_wait_all(
-          poller_ptr.get(),
-          reinterpret_cast<zmq_poller_event_t *>(poller_events.data()),
-          static_cast<int>(poller_events.size()),
-          static_cast<long>(timeout.count()));
-        if (rc > 0)
-            return static_cast<size_t>(rc);
+        return wait_all(poller_events.data(), poller_events.size(), timeout);
+    }
 
-#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 2, 3)
-        if (zmq_errno() == EAGAIN)
-#else
-        if (zmq_errno() == ETIMEDOUT)
-#endif
-            return 0;
+    /*  Waits for events and writes at most capacity of them to events.
 
-        throw error_t();
+        The capacity need not match the number of registered sockets and
+        file descriptors. If more are ready than fit, the ones reported
+        rotate between calls, so that every ready socket is reported
+        within a few calls; the others stay ready for the next wait.
+        Returns: the number of events written, 0 on timeout.
+    */
+    size_t wait_all(event_type *events,
+                    size_t capacity,
+                    const std::chrono::milliseconds timeout)
+    {
+        if (capacity == 0 || capacity >= item_count)
+            return wait_impl(events, capacity, timeout);
+
+        // libzmq reports ready items in registration order, so collect
+        // all of them and pass on a rotating window
+        if (overflow_events.size() < item_count)
+            overflow_events.resize(item_count);
+        const size_t ready =
+          wait_impl(overflow_events.data(), overflow_events.size(), timeout);
+        if (ready <= capacity) {
+            std::copy(overflow_events.begin(),
+                      overflow_events.begin() + static_cast<ptrdiff_t>(ready),
+                      events);
+            return ready;
+        }
+        const size_t start = rotation % ready;
+        for (size_t i = 0; i < capacity; ++i)
+            events[i] = overflow_events[(start + i) % ready];
+        rotation = start + capacity;
+        return capacity;
     }
 
 #if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 3, 3)
@@ -2842,6 +3374,11 @@ template<typename T = no_user_data> class poller_t
     };
 
     std::unique_ptr<void, destroy_poller_t> poller_ptr;
+    // registered sockets and file descriptors
+    size_t item_count = 0;
+    // all ready events, when they may not fit into the caller's buffer
+    std::vector<event_type> overflow_events;
+    size_t rotation = 0;
 
     void add_impl(zmq::socket_ref socket, event_flags events, T *user_data)
     {
@@ -2850,6 +3387,7 @@ template<typename T = no_user_data> class poller_t
                               static_cast<short>(events))) {
             throw error_t();
         }
+        ++item_count;
     }
 
     void add_impl(fd_t fd, event_flags events, T *user_data)
@@ -2859,6 +3397,28 @@ template<typename T = no_user_data> class poller_t
                                  static_cast<short>(events))) {
             throw error_t();
         }
+        ++item_count;
+    }
+
+    size_t wait_impl(event_type *events,
+                     size_t capacity,
+                     const std::chrono::milliseconds timeout)
+    {
+        int rc = zmq_poller_wait_all(poller_ptr.get(),
+                                     reinterpret_cast<zmq_poller_event_t *>(events),
+                                     static_cast<int>(capacity),
+                                     static_cast<long>(timeout.count()));
+        if (rc > 0)
+            return static_cast<size_t>(rc);
+
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 2, 3)
+        if (zmq_errno() == EAGAIN)
+#else
+        if (zmq_errno() == ETIMEDOUT)
+#endif
+            return 0;
+
+        throw error_t();
     }
 };
 #endif //  defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
@@ -2974,7 +3534,7 @@ inline std::string curve_public(const std::string &secret)
 
 inline std::string z85_encode(const std::vector<uint8_t> &data)
 {
-    size_t buffer_size = data.size() * size_t{6} / size_t{5} + 1;
+    size_t buffer_size = data.size() * size_t{5} / size_t{4} + 1;
     std::string buffer(buffer_size, '\0');
     auto *result = zmq_z85_encode(&buffer[0], data.data(), data.size());
     if (result == nullptr)
@@ -2994,6 +3554,173 @@ inline std::vector<uint8_t> z85_decode(const std::string &encoded)
     return dest;
 }
 
+#ifdef ZMQ_CPP11
+// How z85_encode and z85_decode handle sizes that are not a multiple
+// of a Z85 group (4 bytes, 5 characters).
+enum class z85_padding
+{
+    // Sizes must be a multiple of a group, as required by ZMQ RFC 32.
+    none,
+    // A trailing partial group of n bytes is encoded as n + 1 characters,
+    // similar to Ascii85. Encodings without a partial group are standard Z85.
+    partial
+};
+
+namespace detail
+{
+inline const char *z85_encoder() ZMQ_NOTHROW
+{
+    return "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.-:+=^!/*?&<>()[]{}@%$#";
+}
+
+// Maps the characters 32 to 127 to their value, 0xFF if invalid.
+inline const uint8_t *z85_decoder() ZMQ_NOTHROW
+{
+    static const uint8_t decoder[96] = {
+      0xFF, 0x44, 0xFF, 0x54, 0x53, 0x52, 0x48, 0xFF, 0x4B, 0x4C, 0x46, 0x41,
+      0xFF, 0x3F, 0x3E, 0x45, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x08, 0x09, 0x40, 0xFF, 0x49, 0x42, 0x4A, 0x47, 0x51, 0x24, 0x25, 0x26,
+      0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32,
+      0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x4D,
+      0xFF, 0x4E, 0x43, 0xFF, 0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,
+      0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C,
+      0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x4F, 0xFF, 0x50, 0xFF, 0xFF};
+    return decoder;
+}
+
+inline void z85_encode_group(char *dest, uint32_t value) ZMQ_NOTHROW
+{
+    const char *const encoder = z85_encoder();
+    dest[4] = encoder[value % 85];
+    value /= 85;
+    dest[3] = encoder[value % 85];
+    value /= 85;
+    dest[2] = encoder[value % 85];
+    value /= 85;
+    dest[1] = encoder[value % 85];
+    dest[0] = encoder[value / 85];
+}
+
+// Returns false on invalid characters or if the value exceeds 32 bits.
+inline bool z85_decode_group(const unsigned char *src, uint32_t &value) ZMQ_NOTHROW
+{
+    const uint8_t *const decoder = z85_decoder();
+    uint64_t acc = 0;
+    for (size_t i = 0; i < 5; ++i) {
+        const unsigned c = src[i];
+        const uint8_t digit = (c >= 32 && c < 128) ? decoder[c - 32] : 0xFF;
+        if (digit == 0xFF)
+            return false;
+        acc = acc * 85 + digit;
+    }
+    if (acc > 0xFFFFFFFFu)
+        return false;
+    value = static_cast<uint32_t>(acc);
+    return true;
+}
+} // namespace detail
+
+// Number of characters z85_encode writes for size bytes,
+// for z85_padding::none the size must be a multiple of 4.
+ZMQ_CONSTEXPR_FN inline size_t
+z85_encoded_size(size_t size, z85_padding padding = z85_padding::none) ZMQ_NOTHROW
+{
+    return size / 4 * 5
+           + (padding == z85_padding::partial && size % 4 != 0 ? size % 4 + 1 : 0);
+}
+
+// Number of bytes z85_decode writes for size characters,
+// for z85_padding::none the size must be a multiple of 5.
+ZMQ_CONSTEXPR_FN inline size_t
+z85_decoded_size(size_t size, z85_padding padding = z85_padding::none) ZMQ_NOTHROW
+{
+    return size / 5 * 4
+           + (padding == z85_padding::partial && size % 5 > 1 ? size % 5 - 1 : 0);
+}
+
+/*  Encode data as Z85 into a caller provided buffer, without null terminator
+    and without allocating.
+
+    Returns: the number of characters written, i.e. z85_encoded_size(data.size()).
+    Throws: zmq::error_t (EINVAL) if the size of data does not fit the padding
+    policy or dest is too small.
+*/
+inline size_t z85_encode(mutable_buffer dest,
+                         const_buffer data,
+                         z85_padding padding = z85_padding::none)
+{
+    if (padding == z85_padding::none && data.size() % 4 != 0)
+        throw error_t(EINVAL);
+    const size_t encoded_size = z85_encoded_size(data.size(), padding);
+    if (dest.size() < encoded_size)
+        throw error_t(EINVAL);
+
+    const unsigned char *src = static_cast<const unsigned char *>(data.data());
+    const unsigned char *const src_end = src + data.size() / 4 * 4;
+    char *out = static_cast<char *>(dest.data());
+    for (; src != src_end; src += 4, out += 5) {
+        detail::z85_encode_group(out, (static_cast<uint32_t>(src[0]) << 24)
+                                        | (static_cast<uint32_t>(src[1]) << 16)
+                                        | (static_cast<uint32_t>(src[2]) << 8)
+                                        | static_cast<uint32_t>(src[3]));
+    }
+    const size_t tail = data.size() % 4;
+    if (tail != 0) {
+        unsigned char bytes[4] = {0, 0, 0, 0};
+        std::memcpy(bytes, src, tail);
+        char group[5];
+        detail::z85_encode_group(group, (static_cast<uint32_t>(bytes[0]) << 24)
+                                          | (static_cast<uint32_t>(bytes[1]) << 16)
+                                          | (static_cast<uint32_t>(bytes[2]) << 8)
+                                          | static_cast<uint32_t>(bytes[3]));
+        std::memcpy(out, group, tail + 1);
+    }
+    return encoded_size;
+}
+
+/*  Decode Z85 characters into a caller provided buffer, without allocating.
+
+    Returns: the number of bytes written, i.e. z85_decoded_size(encoded.size()).
+    Throws: zmq::error_t (EINVAL) if the size of encoded does not fit the
+    padding policy, if encoded contains invalid characters or groups,
+    or if dest is too small.
+*/
+inline size_t z85_decode(mutable_buffer dest,
+                         const_buffer encoded,
+                         z85_padding padding = z85_padding::none)
+{
+    const size_t tail = encoded.size() % 5;
+    if ((padding == z85_padding::none && tail != 0) || tail == 1)
+        throw error_t(EINVAL);
+    const size_t decoded_size = z85_decoded_size(encoded.size(), padding);
+    if (dest.size() < decoded_size)
+        throw error_t(EINVAL);
+
+    const unsigned char *src = static_cast<const unsigned char *>(encoded.data());
+    const unsigned char *const src_end = src + encoded.size() / 5 * 5;
+    unsigned char *out = static_cast<unsigned char *>(dest.data());
+    uint32_t value = 0;
+    for (; src != src_end; src += 5, out += 4) {
+        if (!detail::z85_decode_group(src, value))
+            throw error_t(EINVAL);
+        out[0] = static_cast<unsigned char>(value >> 24);
+        out[1] = static_cast<unsigned char>(value >> 16);
+        out[2] = static_cast<unsigned char>(value >> 8);
+        out[3] = static_cast<unsigned char>(value);
+    }
+    if (tail != 0) {
+        // pad with the highest digit so that truncation restores the bytes
+        unsigned char group[5] = {'#', '#', '#', '#', '#'};
+        std::memcpy(group, src, tail);
+        if (!detail::z85_decode_group(group, value))
+            throw error_t(EINVAL);
+        for (size_t i = 0; i + 1 < tail; ++i)
+            out[i] = static_cast<unsigned char>(value >> (24 - 8 * i));
+    }
+    return decoded_size;
+}
+#endif
+
 } // namespace zmq
 
 #ifdef _WIN32
@@ -31,9 +31,39 @@
 #include <sstream>
 #include <stdexcept>
 #ifdef ZMQ_CPP11
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <limits>
 #include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__linux__) && !defined(CPPZMQ_HAS_EPOLL)
+#define CPPZMQ_HAS_EPOLL 1
+#endif
+#ifndef CPPZMQ_HAS_EPOLL
+#define CPPZMQ_HAS_EPOLL 0
+#elif CPPZMQ_HAS_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(CPPZMQ_HAS_MMAP)
+#define CPPZMQ_HAS_MMAP 1
+#endif
+#ifndef CPPZMQ_HAS_MMAP
+#define CPPZMQ_HAS_MMAP 0
+#elif CPPZMQ_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace zmq
 {
@@ -155,6 +185,63 @@ inline uint32_t read_u32_network_order(const unsigned char *buf)
         return value;
     }
 }
+
+inline void write_network_order(unsigned char *buf, const uint64_t value)
+{
+    write_network_order(buf, static_cast<uint32_t>(value >> 32));
+    write_network_order(buf + 4, static_cast<uint32_t>(value));
+}
+
+inline uint64_t read_u64_network_order(const unsigned char *buf)
+{
+    return (static_cast<uint64_t>(read_u32_network_order(buf)) << 32)
+           + read_u32_network_order(buf + 4);
+}
+
+// CPUs this process may run on, in ascending order.
+inline std::vector<int> available_cpus()
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    if (cpus.empty()) {
+        const unsigned count = std::thread::hardware_concurrency();
+        for (unsigned cpu = 0; cpu < (count > 0 ? count : 1); ++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+    }
+    return cpus;
+}
+
+// Pin a thread to one CPU. Platforms without an affinity API are a no-op.
+inline void pin_thread(std::thread &thread, int cpu)
+{
+    if (cpu < 0)
+        throw error_t(EINVAL);
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE)
+        throw error_t(EINVAL);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const int rc = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    if (rc != 0)
+        throw error_t(rc);
+#elif defined(_WIN32)
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+        throw error_t(EINVAL);
+    if (SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{1} << cpu) == 0)
+        throw error_t(EINVAL);
+#else
+    (void) thread;
+#endif
+}
 } // namespace detail
 
 /*  Receive a multipart message.
@@ -200,6 +287,358 @@ ZMQ_NODISCARD recv_result_t recv_multipart_n(socket_ref s,
     return detail::recv_multipart_n<true>(s, std::move(out), n, flags);
 }
 
+/*  A fixed-capacity byte arena receiving multipart messages.
+
+    The storage is allocated once on construction. Parts appended to the
+    arena are copied back to back, each one starting at an address aligned
+    to alignof(std::max_align_t), and recorded as zmq::const_buffer in parts().
+    The buffers stay valid until reset() is called or the arena is destroyed.
+    Calling reset() between batches makes steady-state receiving free of
+    heap allocations.
+*/
+class recv_arena
+{
+  public:
+    explicit recv_arena(size_t capacity, size_t max_parts = 16) :
+        _storage(new unsigned char[capacity]), _capacity(capacity), _used(0)
+    {
+        _parts.reserve(max_parts);
+    }
+
+    recv_arena(const recv_arena &) = delete;
+    recv_arena &operator=(const recv_arena &) = delete;
+
+    recv_arena(recv_arena &&) = default;
+    recv_arena &operator=(recv_arena &&) = default;
+
+    // Copy size bytes into the arena and record them as a new part.
+    // Throws std::length_error if the remaining capacity is too small,
+    // in which case the arena is left unchanged.
+    const_buffer append(const void *data, size_t size)
+    {
+        ZMQ_CONSTEXPR_VAR size_t align = alignof(std::max_align_t);
+        const size_t offset = (_used + align - 1) & ~(align - 1);
+        if (offset > _capacity || size > _capacity - offset)
+            throw std::length_error("recv_arena capacity exceeded");
+        unsigned char *dest = _storage.get() + offset;
+        if (size)
+            std::memcpy(dest, data, size);
+        _used = offset + size;
+        _parts.emplace_back(dest, size);
+        return _parts.back();
+    }
+
+    // Discard all parts, keeping the storage for reuse.
+    void reset() ZMQ_NOTHROW
+    {
+        _used = 0;
+        _parts.clear();
+    }
+
+    // The parts appended since the last reset(), in order of arrival.
+    const std::vector<const_buffer> &parts() const ZMQ_NOTHROW { return _parts; }
+
+    // Number of bytes in use, including alignment padding.
+    size_t size() const ZMQ_NOTHROW { return _used; }
+
+    size_t capacity() const ZMQ_NOTHROW { return _capacity; }
+
+    ZMQ_NODISCARD bool empty() const ZMQ_NOTHROW { return _parts.empty(); }
+
+  private:
+    std::unique_ptr<unsigned char[]> _storage;
+    size_t _capacity;
+    size_t _used;
+    std::vector<const_buffer> _parts;
+}; // class recv_arena
+
+/*  Receive a multipart message into an arena.
+
+    Copies each part into the arena and appends a zmq::const_buffer
+    referring to it to arena.parts(), i.e. the received message occupies
+    the last n entries of arena.parts(). A single message_t is reused for
+    all parts, so no per-part message objects are allocated.
+
+    Returns: the number of messages received or nullopt (on EAGAIN).
+    Throws: if recv throws. Throws std::length_error if the arena
+    capacity is exceeded, in which case the message may have been
+    only partially received with pending message parts.
+    It is adviced to close this socket in that event.
+*/
+ZMQ_NODISCARD
+inline recv_result_t recv_multipart_into(socket_ref s,
+                                         recv_arena &arena,
+                                         recv_flags flags = recv_flags::none)
+{
+    size_t msg_count = 0;
+    message_t msg;
+    while (true) {
+        if (!s.recv(msg, flags)) {
+            // zmq ensures atomic delivery of messages
+            assert(msg_count == 0);
+            return {};
+        }
+        ++msg_count;
+        arena.append(msg.data(), msg.size());
+        if (!msg.more())
+            break;
+    }
+    return msg_count;
+}
+
+#if CPPZMQ_HAS_MMAP
+namespace detail
+{
+// A read-only mapping of part of a file, shared by the messages referring
+// to it and unmapped when the last reference is released.
+struct file_mapping
+{
+    file_mapping(void *addr_, size_t length_, size_t skip) ZMQ_NOTHROW
+        : addr(addr_),
+          length(length_),
+          data(static_cast<char *>(addr_) + skip),
+          refs(1)
+    {
+    }
+
+    void *addr;
+    size_t length;
+    // first mapped byte requested, addr is rounded down to a page boundary
+    char *data;
+    std::atomic<size_t> refs;
+};
+
+// free_fn of messages referring to a file_mapping
+inline void release_mapping(void *, void *hint) ZMQ_NOTHROW
+{
+    auto *mapping = static_cast<file_mapping *>(hint);
+    if (--mapping->refs == 0) {
+        ::munmap(mapping->addr, mapping->length);
+        delete mapping;
+    }
+}
+
+inline size_t page_size() ZMQ_NOTHROW
+{
+    return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+inline size_t file_size(int fd)
+{
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+        throw error_t(errno);
+    return static_cast<size_t>(st.st_size);
+}
+
+// Map size > 0 bytes of fd from offset, the caller holds one reference.
+inline file_mapping *map_file(int fd, size_t offset, size_t size)
+{
+    // mmap offsets must be page aligned
+    const size_t skip = offset % page_size();
+    const size_t length = size + skip;
+    void *addr = ::mmap(ZMQ_NULLPTR, length, PROT_READ, MAP_SHARED, fd,
+                        static_cast<off_t>(offset - skip));
+    if (addr == MAP_FAILED)
+        throw error_t(errno);
+    auto *mapping = new (std::nothrow) file_mapping(addr, length, skip);
+    if (!mapping) {
+        ::munmap(addr, length);
+        throw std::bad_alloc();
+    }
+    return mapping;
+}
+
+// A message referring to size bytes at offset into mapping.
+inline message_t mapping_message(file_mapping *mapping, size_t offset, size_t size)
+{
+    ++mapping->refs;
+    try {
+        return message_t(mapping->data + offset, size, &release_mapping, mapping);
+    }
+    catch (...) {
+        release_mapping(ZMQ_NULLPTR, mapping);
+        throw;
+    }
+}
+
+class file_descriptor
+{
+  public:
+    explicit file_descriptor(int fd) : _fd(fd)
+    {
+        if (fd < 0)
+            throw error_t(errno);
+    }
+    ~file_descriptor() { ::close(_fd); }
+
+    file_descriptor(const file_descriptor &) = delete;
+    file_descriptor &operator=(const file_descriptor &) = delete;
+
+    int get() const ZMQ_NOTHROW { return _fd; }
+
+  private:
+    int _fd;
+};
+} // namespace detail
+
+/*  Create a message whose content is a read-only memory mapping of size
+    bytes of the file fd, starting at offset. By default the mapping
+    extends to the end of the file. The pages are unmapped when libzmq
+    releases the message, so sending the message never copies the file
+    to the heap. The file descriptor may be closed once this returns.
+    The content must not be modified.
+
+    Throws: error_t (with errno) if the file cannot be mapped, error_t
+    (EINVAL) if offset lies beyond the end of the file.
+*/
+inline message_t mapped_message(int fd,
+                                size_t offset = 0,
+                                size_t size = (std::numeric_limits<size_t>::max)())
+{
+    const size_t file_size = detail::file_size(fd);
+    if (offset > file_size)
+        throw error_t(EINVAL);
+    size = (std::min)(size, file_size - offset);
+    if (size == 0)
+        return message_t();
+
+    detail::file_mapping *mapping = detail::map_file(fd, offset, size);
+    message_t msg;
+    try {
+        msg = detail::mapping_message(mapping, 0, size);
+    }
+    catch (...) {
+        detail::release_mapping(ZMQ_NULLPTR, mapping);
+        throw;
+    }
+    detail::release_mapping(ZMQ_NULLPTR, mapping);
+    return msg;
+}
+
+inline message_t mapped_message(const std::string &path,
+                                size_t offset = 0,
+                                size_t size = (std::numeric_limits<size_t>::max)())
+{
+    detail::file_descriptor fd(::open(path.c_str(), O_RDONLY));
+    return mapped_message(fd.get(), offset, size);
+}
+
+/*  A file of fixed size mapped writable into memory, e.g. as the target
+    of recv_multipart_into or of a blob_receiver. The file is created if
+    needed and resized to size. Changes reach the file when the mapping
+    is closed or synced.
+*/
+class mapped_file
+{
+  public:
+    mapped_file() ZMQ_NOTHROW : _data(ZMQ_NULLPTR), _size(0) {}
+
+    mapped_file(const std::string &path, size_t size) : _data(ZMQ_NULLPTR), _size(0)
+    {
+        detail::file_descriptor fd(::open(path.c_str(), O_RDWR | O_CREAT, 0644));
+        if (::ftruncate(fd.get(), static_cast<off_t>(size)) != 0)
+            throw error_t(errno);
+        if (size == 0)
+            return;
+        void *addr =
+          ::mmap(ZMQ_NULLPTR, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+        if (addr == MAP_FAILED)
+            throw error_t(errno);
+        _data = addr;
+        _size = size;
+    }
+
+    mapped_file(mapped_file &&rhs) ZMQ_NOTHROW : _data(rhs._data), _size(rhs._size)
+    {
+        rhs._data = ZMQ_NULLPTR;
+        rhs._size = 0;
+    }
+
+    mapped_file &operator=(mapped_file &&rhs) ZMQ_NOTHROW
+    {
+        close();
+        std::swap(_data, rhs._data);
+        std::swap(_size, rhs._size);
+        return *this;
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    ~mapped_file() ZMQ_NOTHROW { close(); }
+
+    void *data() ZMQ_NOTHROW { return _data; }
+    const void *data() const ZMQ_NOTHROW { return _data; }
+    size_t size() const ZMQ_NOTHROW { return _size; }
+
+    // Write the modified pages back to the file.
+    void sync()
+    {
+        if (_data && ::msync(_data, _size, MS_SYNC) != 0)
+            throw error_t(errno);
+    }
+
+    void close() ZMQ_NOTHROW
+    {
+        if (_data)
+            ::munmap(_data, _size);
+        _data = ZMQ_NULLPTR;
+        _size = 0;
+    }
+
+  private:
+    void *_data;
+    size_t _size;
+}; // class mapped_file
+
+/*  Receive a multipart message into a mapped file.
+
+    The parts are written into the file, back to back, starting at
+    offset, which is advanced past the last byte written. This saves
+    writing the file separately, not memory: libzmq receives every part
+    into a heap allocated message of its own first, which zmq_recv then
+    copies into the file, so each part is held in memory as a whole. To
+    receive files larger than what should be buffered at once, send them
+    with a blob_sender and receive them with a blob_receiver into the
+    data() of a mapped_file, which bounds each frame to a chunk.
+
+    Returns: the number of messages received or nullopt (on EAGAIN).
+    Throws: if recv throws. Throws std::length_error if a part does not
+    fit into the rest of the file, in which case the message may have
+    been only partially received with pending message parts.
+    It is adviced to close this socket in that event.
+*/
+ZMQ_NODISCARD
+inline recv_result_t recv_multipart_into(socket_ref s,
+                                         mapped_file &file,
+                                         size_t &offset,
+                                         recv_flags flags = recv_flags::none)
+{
+    if (offset > file.size())
+        throw std::length_error("offset beyond the end of mapped_file");
+    size_t msg_count = 0;
+    while (true) {
+        const auto result = s.recv(
+          mutable_buffer(static_cast<char *>(file.data()) + offset,
+                         file.size() - offset),
+          flags);
+        if (!result) {
+            // zmq ensures atomic delivery of messages
+            assert(msg_count == 0);
+            return {};
+        }
+        ++msg_count;
+        if (result->truncated())
+            throw std::length_error("mapped_file capacity exceeded");
+        offset += result->size;
+        if (!s.get(sockopt::rcvmore))
+            break;
+    }
+    return msg_count;
+}
+#endif // CPPZMQ_HAS_MMAP
+
 /*  Send a multipart message.
     
     The range must be a ForwardRange of zmq::message_t,
@@ -244,6 +683,297 @@ send_multipart(socket_ref s, Range &&msgs, send_flags flags = send_flags::none)
     return msg_count;
 }
 
+/*  Send a reply through a ROUTER socket.
+
+    Sends [identity][""][body...] without building an envelope container.
+    The range must be a ForwardRange of zmq::message_t, zmq::const_buffer
+    or zmq::mutable_buffer, as for send_multipart. The flags apply to all
+    frames, sndmore is added as needed.
+
+    Returns: the number of messages sent, including the identity and the
+    delimiter, or nullopt (on EAGAIN).
+    Throws: if send throws, e.g. EHOSTUNREACH for an unknown identity with
+    sockopt::router_mandatory set.
+*/
+template<class Range
+#ifndef ZMQ_CPP11_PARTIAL
+         ,
+         typename = typename std::enable_if<
+           detail::is_range<Range>::value
+           && (std::is_same<detail::range_value_t<Range>, message_t>::value
+               || detail::is_buffer<detail::range_value_t<Range>>::value)>::type
+#endif
+         >
+send_result_t router_send(socket_ref s,
+                          const_buffer identity,
+                          Range &&body,
+                          send_flags flags = send_flags::none)
+{
+    if (!s.send(identity, flags | send_flags::sndmore))
+        return {};
+    s.send(const_buffer(), flags | send_flags::sndmore);
+    const auto sent = send_multipart(s, std::forward<Range>(body), flags);
+    // zmq ensures atomic delivery of messages
+    assert(sent);
+    return *sent + 2;
+}
+
+inline send_result_t router_send(socket_ref s,
+                                 const_buffer identity,
+                                 const_buffer body,
+                                 send_flags flags = send_flags::none)
+{
+    if (!s.send(identity, flags | send_flags::sndmore))
+        return {};
+    s.send(const_buffer(), flags | send_flags::sndmore);
+    s.send(body, flags);
+    return 3;
+}
+
+inline send_result_t router_send(socket_ref s,
+                                 const_buffer identity,
+                                 message_t &body,
+                                 send_flags flags = send_flags::none)
+{
+    if (!s.send(identity, flags | send_flags::sndmore))
+        return {};
+    s.send(const_buffer(), flags | send_flags::sndmore);
+    s.send(body, flags);
+    return 3;
+}
+
+/*  Receive a request from a ROUTER socket.
+
+    Receives [identity][""][body...] into identity and the n preallocated
+    messages at body, reusing them. The empty delimiter is skipped if
+    present, so peers not sending one, e.g. DEALER sockets, are supported
+    as well.
+
+    Returns: the number of body parts received or nullopt (on EAGAIN).
+    Throws: if recv throws. Throws std::runtime_error if there are more
+    than n body parts, in which case the rest of the message has been
+    received and discarded.
+*/
+ZMQ_NODISCARD
+inline recv_result_t router_recv(socket_ref s,
+                                 message_t &identity,
+                                 message_t *body,
+                                 size_t n,
+                                 recv_flags flags = recv_flags::none)
+{
+    if (!s.recv(identity, flags))
+        return {};
+    size_t count = 0;
+    bool more = identity.more();
+    bool delimiter = true;
+    while (more) {
+        if (count == n) {
+            message_t discard;
+            while (more) {
+                ZMQ_ASSERT(s.recv(discard));
+                more = discard.more();
+            }
+            throw std::runtime_error("Too many message parts in router_recv");
+        }
+        // zmq ensures atomic delivery of messages
+        ZMQ_ASSERT(s.recv(body[count]));
+        more = body[count].more();
+        if (delimiter && body[count].size() == 0 && more) {
+            delimiter = false;
+            continue;
+        }
+        delimiter = false;
+        ++count;
+    }
+    return count;
+}
+
+ZMQ_NODISCARD
+inline recv_result_t router_recv(socket_ref s,
+                                 message_t &identity,
+                                 message_t &body,
+                                 recv_flags flags = recv_flags::none)
+{
+    return router_recv(s, identity, &body, 1, flags);
+}
+
+namespace detail
+{
+template<size_t... I> struct index_sequence
+{
+};
+template<size_t N, size_t... I>
+struct make_index_sequence : make_index_sequence<N - 1, N - 1, I...>
+{
+};
+template<size_t... I> struct make_index_sequence<0, I...>
+{
+    using type = index_sequence<I...>;
+};
+
+// How a frame type of a multipart_schema is viewed when received
+// and passed when sent.
+template<class Frame> struct schema_frame
+{
+    using view_type = message_view<Frame>;
+    static const_buffer to_buffer(const Frame &frame) noexcept
+    {
+        return const_buffer(std::addressof(frame), sizeof(Frame));
+    }
+};
+
+template<class T> struct schema_frame<T[]>
+{
+    using view_type = message_view<T[]>;
+    static const_buffer to_buffer(const_buffer frame) noexcept { return frame; }
+};
+
+template<> struct schema_frame<const_buffer>
+{
+    using view_type = const_buffer;
+    static const_buffer to_buffer(const_buffer frame) noexcept { return frame; }
+};
+} // namespace detail
+
+/*  A multipart message with a fixed number of typed frames.
+
+    Each frame type is one of:
+    - a POD type T: the frame holds exactly one T, viewed as message_view<T>,
+    - an array type T[]: the frame holds any number of T,
+      viewed as message_view<T[]>,
+    - zmq::const_buffer: the frame holds arbitrary bytes.
+
+    recv() receives into message_t objects owned (and reused) by the schema
+    and validates the number of frames as well as all frame sizes and
+    alignments in one pass. The validated frames are then accessed in place
+    through get<I>() or views(). send() sends the frames of a tuple directly,
+    without building a multipart_t.
+
+    Example:
+    `zmq::multipart_schema<zmq::const_buffer, header_t, uint8_t[]> schema;`
+    `if (schema.recv(router)) process(schema.get<1>()->seq, schema.get<2>());`
+*/
+template<class... Frames> class multipart_schema
+{
+  public:
+    static ZMQ_CONSTEXPR_VAR size_t frame_count = sizeof...(Frames);
+    static_assert(frame_count > 0, "multipart_schema requires at least one frame");
+
+    template<size_t I>
+    using view_type = typename detail::schema_frame<
+      typename std::tuple_element<I, std::tuple<Frames...>>::type>::view_type;
+    using views_type = std::tuple<typename detail::schema_frame<Frames>::view_type...>;
+
+    /*  Receive a multipart message with exactly frame_count parts.
+
+        Returns: the number of messages received or nullopt (on EAGAIN).
+        Throws: if recv throws. Throws std::runtime_error if the number of
+        message parts differs from frame_count or if a frame does not match
+        its type. If there are too many parts, the message
+        may have been only partially received with pending
+        message parts. It is adviced to close this socket in that event.
+    */
+    recv_result_t recv(socket_ref s, recv_flags flags = recv_flags::none)
+    {
+        _valid = false;
+        const auto res = detail::recv_multipart_n<true>(s, _parts.data(),
+                                                        frame_count, flags);
+        if (!res)
+            return res;
+        if (*res != frame_count)
+            throw std::runtime_error(
+              "Too few message parts in multipart_schema::recv");
+        validate<0>();
+        _valid = true;
+        return res;
+    }
+
+    // View of frame I of the last received message.
+    template<size_t I> view_type<I> get() const
+    {
+        static_assert(I < frame_count, "frame index out of range");
+        assert(_valid);
+        return view_type<I>(const_buffer(_parts[I].data(), _parts[I].size()));
+    }
+
+    // Views of all frames of the last received message.
+    views_type views() const
+    {
+        return views(typename detail::make_index_sequence<frame_count>::type{});
+    }
+
+    // Message part I of the last received message.
+    message_t &part(size_t i) { return _parts[i]; }
+    const message_t &part(size_t i) const { return _parts[i]; }
+
+    /*  Send a multipart message made of the elements of a tuple.
+
+        Element I is either a Frame I (for POD frames) or a zmq::const_buffer
+        (for array and const_buffer frames), the tuple may hold references,
+        e.g. created by std::tie or std::forward_as_tuple.
+
+        Returns: the number of messages sent (exactly frame_count) or nullopt (on EAGAIN).
+        Throws: if send throws. The message may have been only partially sent.
+        It is adviced to close this socket in that event.
+    */
+    template<class... Values>
+    static send_result_t send(socket_ref s,
+                              const std::tuple<Values...> &frames,
+                              send_flags flags = send_flags::none)
+    {
+        static_assert(sizeof...(Values) == frame_count,
+                      "number of values must match the number of frames");
+        if (!send_frame<0>(s, frames, flags))
+            return {};
+        return frame_count;
+    }
+
+  private:
+    std::array<message_t, frame_count> _parts;
+    bool _valid{false};
+
+    template<size_t I>
+    typename std::enable_if<(I == frame_count)>::type validate() const
+    {
+    }
+    template<size_t I>
+    typename std::enable_if<(I < frame_count)>::type validate() const
+    {
+        (void) view_type<I>(const_buffer(_parts[I].data(), _parts[I].size()));
+        validate<I + 1>();
+    }
+
+    template<size_t... I> views_type views(detail::index_sequence<I...>) const
+    {
+        return views_type(get<I>()...);
+    }
+
+    template<size_t I, class Tuple>
+    static typename std::enable_if<(I == frame_count), bool>::type
+    send_frame(socket_ref, const Tuple &, send_flags)
+    {
+        return true;
+    }
+    template<size_t I, class Tuple>
+    static typename std::enable_if<(I < frame_count), bool>::type
+    send_frame(socket_ref s, const Tuple &frames, send_flags flags)
+    {
+        using frame_t = typename std::tuple_element<I, std::tuple<Frames...>>::type;
+        const auto msg_flags =
+          flags | (I + 1 == frame_count ? send_flags::none : send_flags::sndmore);
+        if (!s.send(detail::schema_frame<frame_t>::to_buffer(std::get<I>(frames)),
+                    msg_flags)) {
+            // zmq ensures atomic delivery of messages
+            assert(I == 0);
+            return false;
+        }
+        return send_frame<I + 1>(s, frames, flags);
+    }
+}; // class multipart_schema
+
+template<class... Frames>
+ZMQ_CONSTEXPR_VAR size_t multipart_schema<Frames...>::frame_count;
+
 /* Encode a multipart message.
 
    The range must be a ForwardRange of zmq::message_t.  A
@@ -356,373 +1086,3393 @@ template<class OutputIt> OutputIt decode(const message_t &encoded, OutputIt out)
     return out;
 }
 
-#endif
-
-
-#ifdef ZMQ_HAS_RVALUE_REFS
+/*  A reusable set of socket options.
 
-/*
-    This class handles multipart messaging. It is the C++ equivalent of zmsg.h,
-    which is part of CZMQ (the high-level C binding). Furthermore, it is a major
-    improvement compared to zmsg.hpp, which is part of the examples in the ØMQ
-    Guide. Unnecessary copying is avoided by using move semantics to efficiently
-    add/remove parts.
+    The option values are encoded once when added and can then be applied
+    to any number of sockets, e.g.
+    `zmq::socket_options opts;`
+    `opts.set(zmq::sockopt::linger, 0).set(zmq::sockopt::sndhwm, 10000);`
+    `opts.apply_all(sockets);`
+    Options are applied in the order they were added, so array options
+    such as sockopt::subscribe may be added repeatedly.
 */
-class multipart_t
+class socket_options
 {
+  public:
+    template<int Opt, class T, bool BoolUnit>
+    socket_options &set(sockopt::integral_option<Opt, T, BoolUnit>, const T &val)
+    {
+        static_assert(std::is_integral<T>::value, "T must be integral");
+        add(Opt, &val, sizeof val);
+        return *this;
+    }
+
+    template<int Opt, class T>
+    socket_options &set(sockopt::integral_option<Opt, T, true>, bool val)
+    {
+        static_assert(std::is_integral<T>::value, "T must be integral");
+        T rep_val = val;
+        add(Opt, &rep_val, sizeof rep_val);
+        return *this;
+    }
+
+    template<int Opt, int NullTerm>
+    socket_options &set(sockopt::array_option<Opt, NullTerm>, const char *buf)
+    {
+        add(Opt, buf, std::strlen(buf));
+        return *this;
+    }
+
+    template<int Opt, int NullTerm>
+    socket_options &set(sockopt::array_option<Opt, NullTerm>, const_buffer buf)
+    {
+        add(Opt, buf.data(), buf.size());
+        return *this;
+    }
+
+    template<int Opt, int NullTerm>
+    socket_options &set(sockopt::array_option<Opt, NullTerm>, const std::string &buf)
+    {
+        add(Opt, buf.data(), buf.size());
+        return *this;
+    }
+
+#if CPPZMQ_HAS_STRING_VIEW
+    template<int Opt, int NullTerm>
+    socket_options &set(sockopt::array_option<Opt, NullTerm>, std::string_view buf)
+    {
+        add(Opt, buf.data(), buf.size());
+        return *this;
+    }
+#endif
+
+    // Set all options on a socket.
+    // Throws: zmq::error_t for the first option libzmq rejects,
+    // options added before it will have been set.
+    void apply(socket_ref s) const
+    {
+        const char *values = _values.data();
+        for (const auto &opt : _options) {
+            int rc = zmq_setsockopt(s.handle(), opt.option, values + opt.offset,
+                                    opt.size);
+            if (rc != 0)
+                throw error_t();
+        }
+    }
+
+    // Set all options on each socket of a range of sockets.
+    template<class Range
+#ifndef ZMQ_CPP11_PARTIAL
+             ,
+             typename = typename std::enable_if<detail::is_range<Range>::value>::type
+#endif
+             >
+    void apply_all(Range &&sockets) const
+    {
+        for (auto &&s : sockets)
+            apply(s);
+    }
+
+    size_t size() const ZMQ_NOTHROW { return _options.size(); }
+
+    ZMQ_NODISCARD bool empty() const ZMQ_NOTHROW { return _options.empty(); }
+
+    void clear() ZMQ_NOTHROW
+    {
+        _options.clear();
+        _values.clear();
+    }
+
   private:
-    std::deque<message_t> m_parts;
+    struct option_value
+    {
+        int option;
+        size_t offset;
+        size_t size;
+    };
 
-  public:
-    typedef std::deque<message_t>::value_type value_type;
+    std::vector<option_value> _options;
+    std::string _values;
 
-    typedef std::deque<message_t>::iterator iterator;
-    typedef std::deque<message_t>::const_iterator const_iterator;
+    void add(int option, const void *data, size_t size)
+    {
+        _options.push_back(option_value{option, _values.size(), size});
+        _values.append(static_cast<const char *>(data), size);
+    }
+}; // class socket_options
 
-    typedef std::deque<message_t>::reverse_iterator reverse_iterator;
-    typedef std::deque<message_t>::const_reverse_iterator const_reverse_iterator;
+/*  A pool of pre-created sockets of one type, configured with one set of
+    options. For sockets of several types or option sets, keep one pool per
+    (socket_type, socket_options) combination, e.g. in a map.
 
-    // Default constructor
-    multipart_t() {}
+    warm_up() creates sockets ahead of time, e.g. at startup or off the hot
+    path, and acquire() hands out one of them, creating a new one only if
+    none is left. This moves the creation and configuration of sockets out
+    of latency sensitive code. Sockets are not returned to the pool: once
+    bound or connected a socket may keep peers and queued messages, and
+    libzmq offers no way to reset it, so acquired sockets are closed by
+    their owner as usual.
 
-    // Construct from socket receive
-    multipart_t(socket_ref socket) { recv(socket); }
+    The pool is not thread-safe and must not outlive its context.
+*/
+class socket_pool
+{
+  public:
+    struct statistics
+    {
+        size_t hits;   // acquire() served from the idle sockets
+        size_t misses; // acquire() had to create a socket
+    };
 
-    // Construct from memory block
-    multipart_t(const void *src, size_t size) { addmem(src, size); }
+    socket_pool(context_t &context,
+                socket_type type,
+                socket_options options = socket_options(),
+                size_t max_idle = 64) :
+        _context(&context),
+        _type(type),
+        _options(std::move(options)),
+        _max_idle(max_idle),
+        _stats()
+    {
+    }
 
-    // Construct from string
-    multipart_t(const std::string &string) { addstr(string); }
+    socket_pool(const socket_pool &) = delete;
+    socket_pool &operator=(const socket_pool &) = delete;
 
-    // Construct from message part
-    multipart_t(message_t &&message) { add(std::move(message)); }
+    socket_pool(socket_pool &&) = default;
+    socket_pool &operator=(socket_pool &&) = default;
 
-    // Move constructor
-    multipart_t(multipart_t &&other) ZMQ_NOTHROW
+    // Create sockets until n (at most max_idle) sockets are idle.
+    void warm_up(size_t n)
     {
-        m_parts = std::move(other.m_parts);
+        n = (std::min)(n, _max_idle);
+        _idle.reserve(n);
+        while (_idle.size() < n)
+            _idle.push_back(create());
     }
 
-    // Move assignment operator
-    multipart_t &operator=(multipart_t &&other) ZMQ_NOTHROW
+    ZMQ_NODISCARD socket_t acquire()
     {
-        m_parts = std::move(other.m_parts);
-        return *this;
+        if (_idle.empty()) {
+            ++_stats.misses;
+            return create();
+        }
+        ++_stats.hits;
+        socket_t s = std::move(_idle.back());
+        _idle.pop_back();
+        return s;
     }
 
-    // Destructor
-    virtual ~multipart_t() { clear(); }
+    // Close all idle sockets.
+    void clear() ZMQ_NOTHROW { _idle.clear(); }
 
-    message_t &operator[](size_t n) { return m_parts[n]; }
+    size_t idle() const ZMQ_NOTHROW { return _idle.size(); }
 
-    const message_t &operator[](size_t n) const { return m_parts[n]; }
+    size_t max_idle() const ZMQ_NOTHROW { return _max_idle; }
 
-    message_t &at(size_t n) { return m_parts.at(n); }
+    socket_type type() const ZMQ_NOTHROW { return _type; }
 
-    const message_t &at(size_t n) const { return m_parts.at(n); }
+    const statistics &stats() const ZMQ_NOTHROW { return _stats; }
 
-    iterator begin() { return m_parts.begin(); }
+  private:
+    context_t *_context;
+    socket_type _type;
+    socket_options _options;
+    size_t _max_idle;
+    statistics _stats;
+    std::vector<socket_t> _idle;
+
+    socket_t create()
+    {
+        socket_t s(*_context, _type);
+        _options.apply(s);
+        return s;
+    }
+}; // class socket_pool
 
-    const_iterator begin() const { return m_parts.begin(); }
+/*  Options of a socket that can not change during its lifetime,
+    read once on construction so that later queries do not call into libzmq.
+    The socket must outlive this object.
+*/
+class socket_info
+{
+  public:
+    explicit socket_info(socket_ref s) :
+        _socket(s),
+        _type(s.get(sockopt::socket_type))
+#ifdef ZMQ_THREAD_SAFE
+        ,
+        _thread_safe(s.get(sockopt::thread_safe) != 0)
+#endif
+    {
+    }
 
-    const_iterator cbegin() const { return m_parts.cbegin(); }
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
 
-    reverse_iterator rbegin() { return m_parts.rbegin(); }
+    socket_type type() const ZMQ_NOTHROW { return _type; }
 
-    const_reverse_iterator rbegin() const { return m_parts.rbegin(); }
+#ifdef ZMQ_THREAD_SAFE
+    bool thread_safe() const ZMQ_NOTHROW { return _thread_safe; }
+#endif
 
-    iterator end() { return m_parts.end(); }
+  private:
+    socket_ref _socket;
+    socket_type _type;
+#ifdef ZMQ_THREAD_SAFE
+    bool _thread_safe;
+#endif
+}; // class socket_info
 
-    const_iterator end() const { return m_parts.end(); }
+/*  Workloads the presets of make_context() and make_socket_options()
+    are tuned for.
+*/
+enum class context_preset
+{
+    low_latency,
+    high_throughput,
+    many_connections
+};
 
-    const_iterator cend() const { return m_parts.cend(); }
+/*  Create a context tuned for a workload, sized by the CPUs available to
+    the process:
 
-    reverse_iterator rend() { return m_parts.rend(); }
+    low_latency       one I/O thread, pinned to the last available CPU when
+                      there are several so that application threads do not
+                      share its core, and copying receive to save an
+                      allocation per incoming batch of small messages.
+    high_throughput   one I/O thread per two CPUs and zero-copy receive.
+    many_connections  one I/O thread per CPU and the highest socket limit
+                      libzmq supports.
 
-    const_reverse_iterator rend() const { return m_parts.rend(); }
+    Thread priority and scheduling policy are left alone, libzmq asserts
+    when the process is not allowed to change them.
+*/
+inline context_t make_context(context_preset preset)
+{
+    const std::vector<int> cpus = detail::available_cpus();
+    const int count = static_cast<int>(cpus.size());
+    context_t context;
+    switch (preset) {
+        case context_preset::low_latency:
+            context.set(ctxopt::io_threads, 1);
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+            if (count > 1)
+                context.set(ctxopt::thread_affinity_cpu_add, cpus.back());
+#endif
+#ifdef ZMQ_ZERO_COPY_RECV
+            context.set(ctxopt::zero_copy_recv, 0);
+#endif
+            break;
+        case context_preset::high_throughput:
+            context.set(ctxopt::io_threads, count > 1 ? count / 2 : 1);
+#ifdef ZMQ_ZERO_COPY_RECV
+            context.set(ctxopt::zero_copy_recv, 1);
+#endif
+            break;
+        case context_preset::many_connections:
+            context.set(ctxopt::io_threads, count);
+#if defined(ZMQ_MAX_SOCKETS) && defined(ZMQ_SOCKET_LIMIT)
+            context.set(ctxopt::max_sockets, context.get(ctxopt::socket_limit));
+#endif
+            break;
+    }
+    return context;
+}
 
-    // Delete all parts
-    void clear() { m_parts.clear(); }
+/*  Socket options recommended for sockets of a context created with
+    make_context(preset): no linger and no queueing to peers that are not
+    connected yet for low_latency, deep queues and large kernel buffers for
+    high_throughput, and shallow queues, a larger accept backlog and TCP
+    keepalives for many_connections.
+*/
+inline socket_options make_socket_options(context_preset preset)
+{
+    socket_options options;
+    switch (preset) {
+        case context_preset::low_latency:
+            options.set(sockopt::linger, 0);
+            options.set(sockopt::immediate, true);
+            break;
+        case context_preset::high_throughput:
+            options.set(sockopt::sndhwm, 100000);
+            options.set(sockopt::rcvhwm, 100000);
+            options.set(sockopt::sndbuf, 4 * 1024 * 1024);
+            options.set(sockopt::rcvbuf, 4 * 1024 * 1024);
+            break;
+        case context_preset::many_connections:
+            options.set(sockopt::linger, 0);
+            options.set(sockopt::sndhwm, 100);
+            options.set(sockopt::rcvhwm, 100);
+            options.set(sockopt::backlog, 1024);
+            options.set(sockopt::tcp_keepalive, 1);
+#ifdef ZMQ_TCP_KEEPALIVE_IDLE
+            options.set(sockopt::tcp_keepalive_idle, 60);
+#endif
+            options.set(sockopt::reconnect_ivl_max, 10000);
+            break;
+    }
+    return options;
+}
 
-    // Get number of parts
-    size_t size() const { return m_parts.size(); }
+/*  Dispatches multipart messages received on a SUB (or XSUB) socket to
+    handlers by the prefix of their first frame.
 
-    // Check if number of parts is zero
-    bool empty() const { return m_parts.empty(); }
+    subscribe() and unsubscribe() update both the socket's subscriptions
+    and a byte-wise prefix trie, so the two stay consistent as long as the
+    socket's subscriptions are only changed through the dispatcher. Each
+    message goes to the handler of the longest subscribed prefix of its
+    topic, found in O(topic length). Handlers may subscribe and unsubscribe,
+    including their own prefix, while they run. The socket must outlive
+    this object.
+*/
+class topic_dispatcher
+{
+  public:
+    using handler_type = std::function<void(std::vector<message_t> &)>;
 
-    // Receive multipart message from socket
-    bool recv(socket_ref socket, int flags = 0)
+    explicit topic_dispatcher(socket_ref socket) : _socket(socket), _nodes(1) {}
+
+    topic_dispatcher(const topic_dispatcher &) = delete;
+    topic_dispatcher &operator=(const topic_dispatcher &) = delete;
+
+    /*  Subscribe to a topic prefix. Subscribing to a prefix again only
+        replaces its handler.
+    */
+    void subscribe(const_buffer prefix, handler_type handler)
     {
-        clear();
-        bool more = true;
-        while (more) {
-            message_t message;
-#ifdef ZMQ_CPP11
-            if (!socket.recv(message, static_cast<recv_flags>(flags)))
-                return false;
-#else
-            if (!socket.recv(&message, flags))
-                return false;
-#endif
-            more = message.more();
-            add(std::move(message));
+        if (!handler)
+            throw std::invalid_argument(
+              "null handler in topic_dispatcher::subscribe");
+        std::uint32_t index = 0;
+        const auto *data = static_cast<const unsigned char *>(prefix.data());
+        for (size_t i = 0; i < prefix.size(); ++i)
+            index = child_or_insert(index, data[i]);
+
+        node &n = _nodes[index];
+        if (n.handler != nil) {
+            _handlers[n.handler] =
+              std::make_shared<handler_type>(std::move(handler));
+            return;
+        }
+        try {
+            _socket.set(sockopt::subscribe, prefix);
+        }
+        catch (...) {
+            prune(prefix);
+            throw;
+        }
+        auto shared = std::make_shared<handler_type>(std::move(handler));
+        if (_free_handlers.empty()) {
+            n.handler = static_cast<std::uint32_t>(_handlers.size());
+            _handlers.push_back(std::move(shared));
+        } else {
+            n.handler = _free_handlers.back();
+            _free_handlers.pop_back();
+            _handlers[n.handler] = std::move(shared);
         }
+        ++_size;
+    }
+
+    void subscribe(const std::string &prefix, handler_type handler)
+    {
+        subscribe(buffer(prefix), std::move(handler));
+    }
+
+    /*  Unsubscribe from a topic prefix.
+        Returns: false if the prefix was not subscribed.
+    */
+    bool unsubscribe(const_buffer prefix)
+    {
+        const std::uint32_t index = find_node(prefix);
+        if (index == nil || _nodes[index].handler == nil)
+            return false;
+        _socket.set(sockopt::unsubscribe, prefix);
+        node &n = _nodes[index];
+        _handlers[n.handler].reset();
+        _free_handlers.push_back(n.handler);
+        n.handler = nil;
+        --_size;
+        prune(prefix);
         return true;
     }
 
-    // Send multipart message to socket
-    bool send(socket_ref socket, int flags = 0)
+    bool unsubscribe(const std::string &prefix)
     {
-        flags &= ~(ZMQ_SNDMORE);
-        bool more = size() > 0;
-        while (more) {
-            message_t message = pop();
-            more = size() > 0;
-#ifdef ZMQ_CPP11
-            if (!socket.send(message, static_cast<send_flags>(
-                                        (more ? ZMQ_SNDMORE : 0) | flags)))
-                return false;
-#else
-            if (!socket.send(message, (more ? ZMQ_SNDMORE : 0) | flags))
-                return false;
-#endif
+        return unsubscribe(buffer(prefix));
+    }
+
+    /*  The handler of the longest subscribed prefix of topic.
+        Returns: nullptr if no subscribed prefix matches.
+    */
+    const handler_type *find(const_buffer topic) const ZMQ_NOTHROW
+    {
+        const std::uint32_t match = find_handler(topic);
+        return match == nil ? ZMQ_NULLPTR : _handlers[match].get();
+    }
+
+    /*  Call the handler matching the first frame of parts.
+        Returns: false if no subscribed prefix matches.
+    */
+    bool dispatch(std::vector<message_t> &parts)
+    {
+        if (parts.empty())
+            return false;
+        const message_t &topic = parts.front();
+        const std::uint32_t match =
+          find_handler(const_buffer(topic.data(), topic.size()));
+        if (match == nil) {
+            ++_unmatched;
+            return false;
         }
-        clear();
+        // keeps the handler alive if it unsubscribes or replaces itself
+        const std::shared_ptr<handler_type> handler = _handlers[match];
+        (*handler)(parts);
         return true;
     }
 
-    // Concatenate other multipart to front
-    void prepend(multipart_t &&other)
+    /*  Receive one multipart message and dispatch it. The parts are kept in
+        a vector reused across calls.
+        Returns: the number of parts received, or nullopt (on EAGAIN).
+    */
+    recv_result_t recv(recv_flags flags = recv_flags::none)
     {
-        while (!other.empty())
-            push(other.remove());
+        _parts.clear();
+        const auto result =
+          recv_multipart(_socket, std::back_inserter(_parts), flags);
+        if (result)
+            dispatch(_parts);
+        return result;
     }
 
-    // Concatenate other multipart to back
-    void append(multipart_t &&other)
+    // subscribed prefixes
+    size_t size() const ZMQ_NOTHROW { return _size; }
+    bool empty() const ZMQ_NOTHROW { return _size == 0; }
+
+    // messages that matched no subscribed prefix
+    size_t unmatched() const ZMQ_NOTHROW { return _unmatched; }
+
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
+
+  private:
+    static ZMQ_CONSTEXPR_VAR std::uint32_t nil = 0xffffffff;
+
+    struct edge
     {
-        while (!other.empty())
-            add(other.pop());
+        unsigned char label;
+        std::uint32_t node;
+    };
+
+    struct node
+    {
+        // sorted by label
+        std::vector<edge> children;
+        std::uint32_t handler = nil;
+    };
+
+    static bool label_less(const edge &e, unsigned char label) ZMQ_NOTHROW
+    {
+        return e.label < label;
     }
 
-    // Push memory block to front
-    void pushmem(const void *src, size_t size)
+    std::uint32_t child(std::uint32_t index, unsigned char label) const ZMQ_NOTHROW
     {
-        m_parts.push_front(message_t(src, size));
+        const auto &children = _nodes[index].children;
+        const auto it =
+          std::lower_bound(children.begin(), children.end(), label, label_less);
+        return it != children.end() && it->label == label ? it->node : nil;
     }
 
-    // Push memory block to back
-    void addmem(const void *src, size_t size)
+    std::uint32_t child_or_insert(std::uint32_t index, unsigned char label)
     {
-        m_parts.push_back(message_t(src, size));
+        const std::uint32_t existing = child(index, label);
+        if (existing != nil)
+            return existing;
+
+        std::uint32_t added;
+        if (_free_nodes.empty()) {
+            added = static_cast<std::uint32_t>(_nodes.size());
+            _nodes.emplace_back();
+        } else {
+            added = _free_nodes.back();
+            _free_nodes.pop_back();
+        }
+        auto &children = _nodes[index].children;
+        children.insert(
+          std::lower_bound(children.begin(), children.end(), label, label_less),
+          edge{label, added});
+        return added;
     }
 
-    // Push string to front
-    void pushstr(const std::string &string)
+    std::uint32_t find_handler(const_buffer topic) const ZMQ_NOTHROW
     {
-        m_parts.push_front(message_t(string.data(), string.size()));
+        std::uint32_t index = 0;
+        std::uint32_t match = _nodes[0].handler;
+        const auto *data = static_cast<const unsigned char *>(topic.data());
+        for (size_t i = 0; i < topic.size(); ++i) {
+            index = child(index, data[i]);
+            if (index == nil)
+                break;
+            if (_nodes[index].handler != nil)
+                match = _nodes[index].handler;
+        }
+        return match;
     }
 
-    // Push string to back
-    void addstr(const std::string &string)
+    std::uint32_t find_node(const_buffer prefix) const ZMQ_NOTHROW
     {
-        m_parts.push_back(message_t(string.data(), string.size()));
+        std::uint32_t index = 0;
+        const auto *data = static_cast<const unsigned char *>(prefix.data());
+        for (size_t i = 0; i < prefix.size() && index != nil; ++i)
+            index = child(index, data[i]);
+        return index;
     }
 
-    // Push type (fixed-size) to front
-    template<typename T> void pushtyp(const T &type)
+    // Remove the nodes along prefix that no longer lead to a handler.
+    void prune(const_buffer prefix)
     {
-        static_assert(!std::is_same<T, std::string>::value,
-                      "Use pushstr() instead of pushtyp<std::string>()");
-        m_parts.push_front(message_t(&type, sizeof(type)));
+        const auto *data = static_cast<const unsigned char *>(prefix.data());
+        // path[i] is the node reached by the first i bytes of prefix
+        std::vector<std::uint32_t> path(1, 0);
+        path.reserve(prefix.size() + 1);
+        for (size_t i = 0; i < prefix.size(); ++i) {
+            const std::uint32_t index = child(path.back(), data[i]);
+            if (index == nil)
+                break;
+            path.push_back(index);
+        }
+        for (size_t length = path.size() - 1; length > 0; --length) {
+            const std::uint32_t index = path[length];
+            node &n = _nodes[index];
+            if (n.handler != nil || !n.children.empty())
+                return;
+            auto &children = _nodes[path[length - 1]].children;
+            children.erase(std::lower_bound(children.begin(), children.end(),
+                                            data[length - 1], label_less));
+            n.children.shrink_to_fit();
+            _free_nodes.push_back(index);
+        }
     }
 
-    // Push type (fixed-size) to back
-    template<typename T> void addtyp(const T &type)
+    socket_ref _socket;
+    std::vector<node> _nodes;
+    std::vector<std::uint32_t> _free_nodes;
+    // shared so that dispatch keeps a handler alive while it runs
+    std::vector<std::shared_ptr<handler_type>> _handlers;
+    std::vector<std::uint32_t> _free_handlers;
+    std::vector<message_t> _parts;
+    size_t _size = 0;
+    size_t _unmatched = 0;
+}; // class topic_dispatcher
+
+/*  Publishes two-frame [topic, value] messages on an XPUB socket and keeps
+    the latest value of up to max_topics topics, so that it can be replayed
+    to late joiners.
+
+    Cached values share their content with the published messages through
+    message_t::copy, so caching does not copy payloads. Updating a topic is
+    O(1); once max_topics topics are cached, publishing a new topic evicts
+    the least recently published one.
+
+    process_subscriptions() reads the subscription frames the XPUB socket
+    reports and replays every cached topic matching a new subscription.
+    XPUB sends the replay to all subscribers of that topic, not only to the
+    new one. Without sockopt::xpub_verbose the socket only reports the first
+    subscription to each prefix. The socket must outlive this object.
+*/
+class last_value_cache
+{
+  public:
+    last_value_cache(socket_ref xpub, size_t max_topics) :
+        _socket(xpub), _max_topics(max_topics)
     {
-        static_assert(!std::is_same<T, std::string>::value,
-                      "Use addstr() instead of addtyp<std::string>()");
-        m_parts.push_back(message_t(&type, sizeof(type)));
+        if (max_topics == 0 || max_topics >= nil)
+            throw std::invalid_argument("invalid last_value_cache capacity");
+        _entries.reserve(max_topics);
+        _index.reserve(max_topics);
+    }
+
+    last_value_cache(const last_value_cache &) = delete;
+    last_value_cache &operator=(const last_value_cache &) = delete;
+
+    /*  Cache value as the latest value of topic and publish both frames.
+        The cache is updated even if sending fails.
+        Returns: the size of the value sent, or nullopt (on EAGAIN).
+    */
+    send_result_t
+    publish(message_t &topic, message_t &value, send_flags flags = send_flags::none)
+    {
+        _key.assign(topic.data<char>(), topic.size());
+        entry &e = _entries[slot(_key)];
+        e.value.copy(value);
+
+        if (!_socket.send(topic, flags | send_flags::sndmore))
+            return {};
+        // the second frame of a multipart message is never rejected once
+        // the first was accepted
+        return _socket.send(value, flags & ~send_flags::sndmore);
+    }
+
+    /*  The latest value cached for topic.
+        Returns: nullptr if topic is not cached.
+    */
+    const message_t *find(const std::string &topic) const
+    {
+        const auto it = _index.find(topic);
+        return it == _index.end() ? ZMQ_NULLPTR : &_entries[it->second].value;
+    }
+
+    /*  Receive the pending subscription frames without blocking and replay
+        the cached topics matching each new subscription, oldest first.
+        Other frames are ignored. If a replay would block (e.g. with
+        sockopt::xpub_nodrop), the next call resumes it before reading
+        further subscriptions. Topics published in the meantime are not
+        replayed, the subscriber received them when they were published.
+        Returns: the number of cached values replayed.
+    */
+    size_t process_subscriptions()
+    {
+        size_t replayed = 0;
+        while (true) {
+            if (!_replaying) {
+                if (!_socket.recv(_frame, recv_flags::dontwait))
+                    return replayed;
+                if (_frame.size() == 0 || *_frame.data<unsigned char>() != 1)
+                    continue;
+                _prefix.assign(_frame.data<char>() + 1, _frame.size() - 1);
+                _replayed_until = 0;
+                _replay_end = _sequence;
+                _replaying = true;
+            }
+            // entries are in publish order, oldest first
+            for (std::uint32_t i = _tail; i != nil; i = _entries[i].prev) {
+                entry &e = _entries[i];
+                if (e.sequence > _replay_end)
+                    break;
+                if (e.sequence <= _replayed_until
+                    || e.topic.compare(0, _prefix.size(), _prefix) != 0)
+                    continue;
+                if (!replay(e))
+                    return replayed;
+                _replayed_until = e.sequence;
+                ++replayed;
+            }
+            _replaying = false;
+        }
+    }
+
+    // cached topics
+    size_t size() const ZMQ_NOTHROW { return _index.size(); }
+    bool empty() const ZMQ_NOTHROW { return _index.empty(); }
+    size_t max_topics() const ZMQ_NOTHROW { return _max_topics; }
+
+    // topics dropped from the cache to stay within max_topics
+    size_t evicted() const ZMQ_NOTHROW { return _evicted; }
+
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
+
+  private:
+    static ZMQ_CONSTEXPR_VAR std::uint32_t nil = 0xffffffff;
+
+    struct entry
+    {
+        std::string topic;
+        message_t value;
+        // position in publish order, increasing from 1
+        uint64_t sequence = 0;
+        // neighbours in publish order, _head is the most recent
+        std::uint32_t prev = nil;
+        std::uint32_t next = nil;
+    };
+
+    // Find or allocate the entry of topic and make it the most recent.
+    std::uint32_t slot(const std::string &topic)
+    {
+        const auto it = _index.find(topic);
+        std::uint32_t i;
+        if (it != _index.end()) {
+            i = it->second;
+            unlink(i);
+        } else if (_entries.size() < _max_topics) {
+            i = static_cast<std::uint32_t>(_entries.size());
+            _entries.emplace_back();
+            _entries[i].topic = topic;
+            _index.emplace(topic, i);
+        } else {
+            i = _tail;
+            unlink(i);
+            _index.erase(_entries[i].topic);
+            _entries[i].topic = topic;
+            _index.emplace(topic, i);
+            ++_evicted;
+        }
+        _entries[i].sequence = ++_sequence;
+        _entries[i].next = _head;
+        if (_head != nil)
+            _entries[_head].prev = i;
+        _head = i;
+        if (_tail == nil)
+            _tail = i;
+        return i;
+    }
+
+    void unlink(std::uint32_t i) ZMQ_NOTHROW
+    {
+        entry &e = _entries[i];
+        if (e.prev != nil)
+            _entries[e.prev].next = e.next;
+        else
+            _head = e.next;
+        if (e.next != nil)
+            _entries[e.next].prev = e.prev;
+        else
+            _tail = e.prev;
+        e.prev = e.next = nil;
+    }
+
+    bool replay(entry &e)
+    {
+        message_t value;
+        value.copy(e.value);
+        if (!_socket.send(buffer(e.topic),
+                          send_flags::sndmore | send_flags::dontwait))
+            return false;
+        _socket.send(value, send_flags::dontwait);
+        return true;
+    }
+
+    socket_ref _socket;
+    size_t _max_topics;
+    std::vector<entry> _entries;
+    std::unordered_map<std::string, std::uint32_t> _index;
+    std::uint32_t _head = nil;
+    std::uint32_t _tail = nil;
+    std::string _key;
+    message_t _frame;
+    size_t _evicted = 0;
+    uint64_t _sequence = 0;
+    // the subscription being replayed, up to the topics published before it
+    // arrived
+    bool _replaying = false;
+    std::string _prefix;
+    uint64_t _replayed_until = 0;
+    uint64_t _replay_end = 0;
+}; // class last_value_cache
+
+/*  A routing id, e.g. the first frame received on a ROUTER socket, stored
+    inline. ZMTP limits routing ids to 255 bytes, so a routing_id never
+    allocates and can be copied and compared without touching the heap.
+*/
+class routing_id
+{
+  public:
+    static ZMQ_CONSTEXPR_VAR size_t max_size = 255;
+
+    routing_id() ZMQ_NOTHROW : _size(0) {}
+
+    // Throws: std::length_error if id is longer than max_size.
+    explicit routing_id(const_buffer id) { assign(id); }
+
+    explicit routing_id(const message_t &id)
+    {
+        assign(const_buffer(id.data(), id.size()));
+    }
+
+    // Throws: std::length_error if id is longer than max_size.
+    void assign(const_buffer id)
+    {
+        if (id.size() > max_size)
+            throw std::length_error("routing id longer than 255 bytes");
+        if (id.size() > 0)
+            std::memcpy(_data.data(), id.data(), id.size());
+        _size = static_cast<unsigned char>(id.size());
+    }
+
+    const void *data() const ZMQ_NOTHROW { return _data.data(); }
+    size_t size() const ZMQ_NOTHROW { return _size; }
+    bool empty() const ZMQ_NOTHROW { return _size == 0; }
+
+    const_buffer buffer() const ZMQ_NOTHROW
+    {
+        return const_buffer(_data.data(), _size);
+    }
+
+    std::string to_string() const
+    {
+        return std::string(reinterpret_cast<const char *>(_data.data()), _size);
+    }
+
+    bool equals(const_buffer id) const ZMQ_NOTHROW
+    {
+        return id.size() == _size
+               && (_size == 0 || std::memcmp(_data.data(), id.data(), _size) == 0);
+    }
+
+    bool operator==(const routing_id &other) const ZMQ_NOTHROW
+    {
+        return equals(other.buffer());
+    }
+
+    bool operator!=(const routing_id &other) const ZMQ_NOTHROW
+    {
+        return !(*this == other);
+    }
+
+  private:
+    unsigned char _size;
+    // only the first _size bytes are initialized
+    std::array<unsigned char, max_size> _data;
+}; // class routing_id
+
+/*  A hash table from routing ids to V, for ROUTER based services keeping
+    per peer state.
+
+    Lookups take the id as a const_buffer or message_t, e.g. the identity
+    frame just received, and neither copy nor allocate. Keys are stored
+    inline in a dense array of entries and found through an open
+    addressing index with linear probing, which keeps a lookup to a couple
+    of cache lines. Ids are hashed with zmq::hash and a per table seed, so
+    peers choosing their own routing ids cannot easily force collisions.
+
+    Iteration visits the entries in no particular order; inserting or
+    erasing invalidates iterators and pointers to values. Keys must not be
+    modified through an iterator.
+*/
+template<class V> class routing_table
+{
+  public:
+    typedef routing_id key_type;
+    typedef V mapped_type;
+    typedef std::pair<routing_id, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    routing_table() :
+        _seed(detail::hash_avalanche(
+          static_cast<uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count())
+          ^ reinterpret_cast<uintptr_t>(this)))
+    {
+    }
+
+    // Returns: the value of id, or nullptr if id is not in the table.
+    V *find(const_buffer id) ZMQ_NOTHROW
+    {
+        const size_t slot = lookup(id, hash(id, _seed));
+        return slot == npos ? ZMQ_NULLPTR
+                            : &_entries[_slots[slot].entry].second;
+    }
+
+    const V *find(const_buffer id) const ZMQ_NOTHROW
+    {
+        return const_cast<routing_table *>(this)->find(id);
+    }
+
+    V *find(const message_t &id) ZMQ_NOTHROW
+    {
+        return find(const_buffer(id.data(), id.size()));
+    }
+
+    const V *find(const message_t &id) const ZMQ_NOTHROW
+    {
+        return find(const_buffer(id.data(), id.size()));
+    }
+
+    bool contains(const_buffer id) const ZMQ_NOTHROW
+    {
+        return find(id) != ZMQ_NULLPTR;
+    }
+
+    /*  Inserts id with a value constructed from args, unless id is already
+        in the table.
+        Returns: the value of id and whether it was inserted.
+        Throws: std::length_error if id is longer than routing_id::max_size.
+    */
+    template<class... Args>
+    std::pair<V *, bool> emplace(const_buffer id, Args &&...args)
+    {
+        const uint64_t h = hash(id, _seed);
+        const size_t slot = lookup(id, h);
+        if (slot != npos)
+            return std::make_pair(&_entries[_slots[slot].entry].second, false);
+        if (id.size() > routing_id::max_size)
+            throw std::length_error("routing id longer than 255 bytes");
+        if ((_entries.size() + 1) * 4 > _slots.size() * 3)
+            rehash(_slots.empty() ? 16 : 2 * _slots.size());
+
+        _entries.emplace_back(std::piecewise_construct,
+                              std::forward_as_tuple(id),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+        const std::uint32_t entry = static_cast<std::uint32_t>(_entries.size() - 1);
+        _slots[free_slot(static_cast<std::uint32_t>(h))] = {
+          entry, static_cast<std::uint32_t>(h)};
+        return std::make_pair(&_entries.back().second, true);
+    }
+
+    template<class... Args>
+    std::pair<V *, bool> emplace(const message_t &id, Args &&...args)
+    {
+        return emplace(const_buffer(id.data(), id.size()),
+                       std::forward<Args>(args)...);
+    }
+
+    // Returns: the value of id, inserting a value initialized one if needed.
+    V &operator[](const_buffer id) { return *emplace(id).first; }
+    V &operator[](const message_t &id) { return *emplace(id).first; }
+
+    // Returns: whether id was in the table.
+    bool erase(const_buffer id) ZMQ_NOTHROW
+    {
+        const size_t slot = lookup(id, hash(id, _seed));
+        if (slot == npos)
+            return false;
+        const std::uint32_t entry = _slots[slot].entry;
+        remove_slot(slot);
+
+        // keep the entries dense by moving the last one into the gap
+        const std::uint32_t last = static_cast<std::uint32_t>(_entries.size() - 1);
+        if (entry != last) {
+            const routing_id &moved = _entries[last].first;
+            size_t i = hash(moved.buffer(), _seed) & mask();
+            while (_slots[i].entry != last)
+                i = (i + 1) & mask();
+            _slots[i].entry = entry;
+            _entries[entry] = std::move(_entries[last]);
+        }
+        _entries.pop_back();
+        return true;
+    }
+
+    bool erase(const message_t &id) ZMQ_NOTHROW
+    {
+        return erase(const_buffer(id.data(), id.size()));
+    }
+
+    void clear() ZMQ_NOTHROW
+    {
+        _entries.clear();
+        std::fill(_slots.begin(), _slots.end(), slot_t{nil, 0});
+    }
+
+    // Allocates room for n entries, so that no insert until then rehashes.
+    void reserve(size_t n)
+    {
+        size_t slots = 16;
+        while (n * 4 > slots * 3)
+            slots *= 2;
+        if (slots > _slots.size())
+            rehash(slots);
+        _entries.reserve(n);
+    }
+
+    size_t size() const ZMQ_NOTHROW { return _entries.size(); }
+    bool empty() const ZMQ_NOTHROW { return _entries.empty(); }
+
+    iterator begin() ZMQ_NOTHROW { return _entries.begin(); }
+    iterator end() ZMQ_NOTHROW { return _entries.end(); }
+    const_iterator begin() const ZMQ_NOTHROW { return _entries.begin(); }
+    const_iterator end() const ZMQ_NOTHROW { return _entries.end(); }
+
+  private:
+    static ZMQ_CONSTEXPR_VAR std::uint32_t nil = 0xffffffff;
+    static ZMQ_CONSTEXPR_VAR size_t npos = static_cast<size_t>(-1);
+
+    struct slot_t
+    {
+        std::uint32_t entry;
+        // low bits of the hash, the home slot is tag & mask()
+        std::uint32_t tag;
+    };
+
+    size_t mask() const ZMQ_NOTHROW { return _slots.size() - 1; }
+
+    size_t lookup(const_buffer id, uint64_t h) const ZMQ_NOTHROW
+    {
+        if (_slots.empty())
+            return npos;
+        const std::uint32_t tag = static_cast<std::uint32_t>(h);
+        for (size_t i = tag & mask();; i = (i + 1) & mask()) {
+            const slot_t &s = _slots[i];
+            if (s.entry == nil)
+                return npos;
+            if (s.tag == tag && _entries[s.entry].first.equals(id))
+                return i;
+        }
+    }
+
+    size_t free_slot(std::uint32_t tag) const ZMQ_NOTHROW
+    {
+        size_t i = tag & mask();
+        while (_slots[i].entry != nil)
+            i = (i + 1) & mask();
+        return i;
+    }
+
+    // Empties the slot and shifts the following ones of its probe sequence
+    // back, so that lookups never need tombstones.
+    void remove_slot(size_t hole) ZMQ_NOTHROW
+    {
+        for (size_t i = (hole + 1) & mask(); _slots[i].entry != nil;
+             i = (i + 1) & mask()) {
+            const size_t home = _slots[i].tag & mask();
+            if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                _slots[hole] = _slots[i];
+                hole = i;
+            }
+        }
+        _slots[hole].entry = nil;
+    }
+
+    void rehash(size_t slots)
+    {
+        _slots.assign(slots, slot_t{nil, 0});
+        for (size_t e = 0; e < _entries.size(); ++e) {
+            const std::uint32_t tag =
+              static_cast<std::uint32_t>(hash(_entries[e].first.buffer(), _seed));
+            _slots[free_slot(tag)] = {static_cast<std::uint32_t>(e), tag};
+        }
+    }
+
+    uint64_t _seed;
+    std::vector<value_type> _entries;
+    // power of two sized, at most three quarters used
+    std::vector<slot_t> _slots;
+}; // class routing_table
+
+/*  Load-balancing broker between a ROUTER socket facing clients (frontend)
+    and a ROUTER socket facing workers (backend).
+
+    Workers announce themselves with a ready message, [""][credits], where
+    credits is a frame made by credit_frame() giving the number of requests
+    the worker accepts at once (at most 4096 are kept). Any other single
+    frame, e.g. "READY" from a REQ worker, grants one credit. Requests are
+    passed on as [worker id][""][client envelope...][body...] and workers reply
+    with [""][client envelope...][body...]; each reply returns one credit.
+
+    Every credit is an entry in a ready queue, so requests go to workers in
+    the order they became available and workers that answer faster receive
+    more of them. Requests are only read from the frontend while there are
+    credits. Frames are moved between the sockets without being copied and
+    workers are looked up by their identity frame in a routing_table, which
+    neither copies nor allocates. Both sockets
+    must outlive this object. Workers are never forgotten, detecting dead
+    workers is left to the application protocol.
+*/
+class lb_broker
+{
+  public:
+    lb_broker(socket_ref frontend, socket_ref backend) :
+        _frontend(frontend), _backend(backend)
+    {
+    }
+
+    lb_broker(const lb_broker &) = delete;
+    lb_broker &operator=(const lb_broker &) = delete;
+
+    /*  The frame of a ready message granting credits: "CREDIT" followed by
+        credits as a 4 byte unsigned integer in network byte order.
+    */
+    static message_t credit_frame(std::uint32_t credits)
+    {
+        message_t frame(credit_prefix_size + 4);
+        auto *data = static_cast<unsigned char *>(frame.data());
+        std::memcpy(data, credit_prefix(), credit_prefix_size);
+        detail::write_network_order(data + credit_prefix_size, credits);
+        return frame;
+    }
+
+    /*  Wait up to timeout for messages on the backend and, while there are
+        credits, on the frontend, then route what is pending.
+        Returns: the number of messages routed.
+    */
+    size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds{-1})
+    {
+        zmq_pollitem_t items[] = {{_backend.handle(), 0, ZMQ_POLLIN, 0},
+                                  {_frontend.handle(), 0, ZMQ_POLLIN, 0}};
+        zmq::poll(items, _ready_size > 0 ? 2 : 1, timeout);
+
+        size_t routed = 0;
+        if (items[0].revents & ZMQ_POLLIN) {
+            // bounded, so that a busy backend cannot starve the frontend
+            while (routed < batch && route_backend())
+                ++routed;
+        }
+        if (items[1].revents & ZMQ_POLLIN) {
+            // bounded by the credits
+            while (route_frontend())
+                ++routed;
+        }
+        return routed;
+    }
+
+    /*  Route one message from the backend without blocking. Malformed
+        messages are dropped.
+        Returns: false if no message was pending.
+    */
+    bool route_backend()
+    {
+        _parts.clear();
+        if (!recv_multipart(_backend, std::back_inserter(_parts),
+                            recv_flags::dontwait))
+            return false;
+        if (_parts.size() < 3 || _parts[1].size() != 0
+            || _parts[0].size() > routing_id::max_size) {
+            ++_dropped;
+            return true;
+        }
+        const std::uint32_t index = worker_index(_parts[0]);
+        if (_parts.size() == 3) {
+            grant(index, credit_count(_parts[2]));
+            return true;
+        }
+
+        const size_t last = _parts.size() - 1;
+        for (size_t i = 2; i < last; ++i)
+            _frontend.send(_parts[i], send_flags::sndmore);
+        _frontend.send(_parts[last], send_flags::none);
+        ++_replies;
+        grant(index, 1);
+        return true;
+    }
+
+    /*  Route one request from the frontend to the next ready worker without
+        blocking.
+        Returns: false if there are no credits or no request was pending.
+    */
+    bool route_frontend()
+    {
+        if (_ready_size == 0)
+            return false;
+        _parts.clear();
+        if (!recv_multipart(_frontend, std::back_inserter(_parts),
+                            recv_flags::dontwait))
+            return false;
+
+        worker &w = _workers[_ready[_ready_head]];
+        _ready_head = (_ready_head + 1) % _ready.size();
+        --_ready_size;
+        --w.credits;
+
+        _backend.send(w.id.buffer(), send_flags::sndmore);
+        _backend.send(const_buffer(ZMQ_NULLPTR, 0), send_flags::sndmore);
+        const size_t last = _parts.size() - 1;
+        for (size_t i = 0; i < last; ++i)
+            _backend.send(_parts[i], send_flags::sndmore);
+        _backend.send(_parts[last], send_flags::none);
+        ++_requests;
+        return true;
+    }
+
+    // known workers
+    size_t workers() const ZMQ_NOTHROW { return _workers.size(); }
+
+    // requests that can be routed before a worker returns a credit
+    size_t credits() const ZMQ_NOTHROW { return _ready_size; }
+
+    size_t requests() const ZMQ_NOTHROW { return _requests; }
+    size_t replies() const ZMQ_NOTHROW { return _replies; }
+    size_t dropped() const ZMQ_NOTHROW { return _dropped; }
+
+    socket_ref frontend() const ZMQ_NOTHROW { return _frontend; }
+    socket_ref backend() const ZMQ_NOTHROW { return _backend; }
+
+  private:
+    static ZMQ_CONSTEXPR_VAR size_t batch = 256;
+    static ZMQ_CONSTEXPR_VAR std::uint32_t max_credits = 4096;
+    static ZMQ_CONSTEXPR_VAR size_t credit_prefix_size = 6;
+
+    static const char *credit_prefix() ZMQ_NOTHROW { return "CREDIT"; }
+
+    struct worker
+    {
+        routing_id id;
+        std::uint32_t credits;
+    };
+
+    std::uint32_t worker_index(const message_t &id)
+    {
+        if (const std::uint32_t *index = _index.find(id))
+            return *index;
+        worker added;
+        added.id = routing_id(id);
+        added.credits = 0;
+        _workers.push_back(added);
+        const std::uint32_t index = static_cast<std::uint32_t>(_workers.size() - 1);
+        _index.emplace(id, index);
+        return index;
+    }
+
+    // credits granted by the frame of a ready message
+    static std::uint32_t credit_count(const message_t &frame) ZMQ_NOTHROW
+    {
+        if (frame.size() != credit_prefix_size + 4
+            || std::memcmp(frame.data(), credit_prefix(), credit_prefix_size) != 0)
+            return 1;
+        return detail::read_u32_network_order(frame.data<unsigned char>()
+                                              + credit_prefix_size);
+    }
+
+    void grant(std::uint32_t index, std::uint32_t credits)
+    {
+        credits = (std::min)(credits, max_credits - _workers[index].credits);
+        for (; credits > 0; --credits) {
+            if (_ready_size == _ready.size())
+                grow();
+            _ready[(_ready_head + _ready_size) % _ready.size()] = index;
+            ++_ready_size;
+            ++_workers[index].credits;
+        }
+    }
+
+    void grow()
+    {
+        std::vector<std::uint32_t> ready(_ready.empty() ? 16 : 2 * _ready.size());
+        for (size_t i = 0; i < _ready_size; ++i)
+            ready[i] = _ready[(_ready_head + i) % _ready.size()];
+        _ready.swap(ready);
+        _ready_head = 0;
+    }
+
+    socket_ref _frontend;
+    socket_ref _backend;
+    std::vector<worker> _workers;
+    routing_table<std::uint32_t> _index;
+    // ring of worker indices, one entry per credit
+    std::vector<std::uint32_t> _ready;
+    size_t _ready_head = 0;
+    size_t _ready_size = 0;
+    std::vector<message_t> _parts;
+    size_t _requests = 0;
+    size_t _replies = 0;
+    size_t _dropped = 0;
+}; // class lb_broker
+
+namespace detail
+{
+// [blob id][offset][blob size]
+ZMQ_CONSTEXPR_VAR size_t blob_header_size = 20;
+// [blob id][bytes received], or all ones instead of the bytes received if
+// the receiver rejects the blob
+ZMQ_CONSTEXPR_VAR size_t blob_ack_size = 12;
+ZMQ_CONSTEXPR_VAR uint64_t blob_rejected = (std::numeric_limits<uint64_t>::max)();
+} // namespace detail
+
+/*  Sends large blobs over a DEALER socket connected to a ROUTER socket
+    served by a blob_receiver.
+
+    A blob is split into chunks of chunk_size bytes, each sent as a
+    [header][data] message. At most window chunks are unacknowledged at any
+    time; the receiver acknowledges every chunk it has copied out, which
+    grants the credit for the next one. This bounds the memory queued in
+    the pipes and keeps the connection busy without ever blocking it with
+    a single huge frame.
+
+    send() returns once the last chunk is acknowledged. A receive timeout
+    (sockopt::rcvtimeo) set on the socket limits the wait for each
+    acknowledgement. The socket must outlive this object and must not be
+    used for anything else while a blob is being sent.
+*/
+class blob_sender
+{
+  public:
+    explicit blob_sender(socket_ref socket,
+                         size_t chunk_size = 128 * 1024,
+                         size_t window = 16) :
+        _socket(socket), _chunk_size(chunk_size), _window(window)
+    {
+        if (chunk_size == 0 || window == 0)
+            throw std::invalid_argument("invalid blob_sender chunk size or window");
+    }
+
+    /*  Send a copy of blob in chunks.
+        Throws: error_t (EAGAIN) if an acknowledgement times out,
+        std::length_error if the receiver rejects the blob, as it is too
+        large or arrived out of sequence.
+    */
+    void send(const_buffer blob)
+    {
+        const char *data = static_cast<const char *>(blob.data());
+        transfer(blob.size(), [data](size_t offset, size_t size) {
+            return message_t(data + offset, size);
+        });
+    }
+
+#if CPPZMQ_HAS_MMAP
+    /*  Send the contents of a file in chunks referring to a read-only
+        memory mapping of it, so the file is never copied to the heap.
+        Throws: as send(const_buffer), error_t (with errno) if the file
+        cannot be mapped.
+    */
+    void send_file(const std::string &path)
+    {
+        detail::file_descriptor fd(::open(path.c_str(), O_RDONLY));
+        const size_t size = detail::file_size(fd.get());
+        if (size == 0) {
+            send(const_buffer());
+            return;
+        }
+        detail::file_mapping *mapping = detail::map_file(fd.get(), 0, size);
+        try {
+            transfer(size, [mapping](size_t offset, size_t chunk) {
+                return detail::mapping_message(mapping, offset, chunk);
+            });
+        }
+        catch (...) {
+            detail::release_mapping(ZMQ_NULLPTR, mapping);
+            throw;
+        }
+        detail::release_mapping(ZMQ_NULLPTR, mapping);
+    }
+#endif
+
+    size_t chunk_size() const ZMQ_NOTHROW { return _chunk_size; }
+    size_t window() const ZMQ_NOTHROW { return _window; }
+
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
+
+  private:
+    template<class MakeChunk> void transfer(size_t size, MakeChunk make_chunk)
+    {
+        const uint32_t id = ++_blob_id;
+        // an empty blob is sent as one empty chunk
+        const size_t chunks = size == 0 ? 1 : (size - 1) / _chunk_size + 1;
+        size_t sent = 0;
+        size_t acked = 0;
+        unsigned char header[detail::blob_header_size];
+        detail::write_network_order(header, id);
+        detail::write_network_order(header + 12, static_cast<uint64_t>(size));
+
+        while (acked < chunks) {
+            for (; sent < chunks && sent - acked < _window; ++sent) {
+                const size_t offset = sent * _chunk_size;
+                detail::write_network_order(header + 4,
+                                            static_cast<uint64_t>(offset));
+                message_t chunk =
+                  make_chunk(offset, (std::min)(_chunk_size, size - offset));
+                _socket.send(buffer(header), send_flags::sndmore);
+                _socket.send(chunk, send_flags::none);
+            }
+
+            if (!_socket.recv(_ack))
+                throw error_t(EAGAIN);
+            if (_ack.size() != detail::blob_ack_size
+                || detail::read_u32_network_order(_ack.data<unsigned char>())
+                     != id)
+                continue; // left over from an earlier blob
+            if (detail::read_u64_network_order(_ack.data<unsigned char>() + 4)
+                == detail::blob_rejected)
+                throw std::length_error("blob rejected by the receiver");
+            ++acked;
+        }
+    }
+
+    socket_ref _socket;
+    size_t _chunk_size;
+    size_t _window;
+    uint32_t _blob_id = 0;
+    message_t _ack;
+}; // class blob_sender
+
+/*  Receives blobs sent by blob_senders on a ROUTER socket and reassembles
+    them into a caller supplied buffer.
+
+    Blobs are received one at a time. Chunks of other senders arriving in
+    the meantime are kept, they are at most one window per sender, and
+    delivered by the following calls to recv(). The socket must outlive
+    this object and must not be used for anything else.
+*/
+class blob_receiver
+{
+  public:
+    explicit blob_receiver(socket_ref socket) : _socket(socket) {}
+
+    blob_receiver(const blob_receiver &) = delete;
+    blob_receiver &operator=(const blob_receiver &) = delete;
+
+    /*  Receive the next blob into buffer.
+        Returns: the size of the blob.
+        Throws: error_t (EAGAIN) if a receive timeout (sockopt::rcvtimeo)
+        expires, std::length_error if the blob is larger than buffer,
+        std::runtime_error if a chunk arrives out of sequence. In both
+        cases the sender is told to give up and the rest of the blob is
+        discarded.
+    */
+    size_t recv(mutable_buffer buffer)
+    {
+        _active = false;
+        for (auto it = _deferred.begin(); it != _deferred.end();) {
+            const chunk_status status = accept(*it, buffer);
+            if (status == chunk_status::other) {
+                ++it;
+                continue;
+            }
+            it = _deferred.erase(it);
+            if (status == chunk_status::rejected)
+                throw std::length_error("blob larger than the receive buffer");
+            if (done())
+                return _size;
+        }
+
+        for (;;) {
+            chunk c;
+            if (!recv_chunk(c))
+                continue;
+            const chunk_status status = accept(c, buffer);
+            if (status == chunk_status::other)
+                _deferred.push_back(std::move(c));
+            else if (status == chunk_status::rejected)
+                throw std::length_error("blob larger than the receive buffer");
+            else if (done())
+                return _size;
+        }
+    }
+
+    // routing id of the sender of the last blob received
+    const message_t &sender() const ZMQ_NOTHROW { return _sender; }
+
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
+
+  private:
+    struct chunk
+    {
+        message_t routing_id;
+        message_t header;
+        message_t data;
+    };
+
+    enum class chunk_status
+    {
+        accepted,
+        // part of another blob than the one being received
+        other,
+        // the first chunk of a blob too large for the buffer
+        rejected
+    };
+
+    bool done() const ZMQ_NOTHROW { return _active && _received == _size; }
+
+    // Returns false for malformed messages, which are dropped.
+    bool recv_chunk(chunk &c)
+    {
+        if (!_socket.recv(c.routing_id))
+            throw error_t(EAGAIN);
+        bool valid = c.routing_id.more() && _socket.recv(c.header)
+                     && c.header.more() && _socket.recv(c.data)
+                     && c.header.size() == detail::blob_header_size;
+        message_t rest;
+        while (_socket.get(sockopt::rcvmore)) {
+            valid = false;
+            (void) _socket.recv(rest);
+        }
+        return valid;
+    }
+
+    chunk_status accept(chunk &c, mutable_buffer buffer)
+    {
+        const auto *header = c.header.data<unsigned char>();
+        const uint32_t id = detail::read_u32_network_order(header);
+        const uint64_t offset = detail::read_u64_network_order(header + 4);
+        const uint64_t size = detail::read_u64_network_order(header + 12);
+
+        if (!_active) {
+            // the rest of a rejected or abandoned blob is dropped
+            if (offset != 0)
+                return chunk_status::accepted;
+            if (size > buffer.size()) {
+                ack(c.routing_id, id, detail::blob_rejected);
+                return chunk_status::rejected;
+            }
+            _sender.copy(c.routing_id);
+            _blob_id = id;
+            _size = static_cast<size_t>(size);
+            _received = 0;
+            _active = true;
+        } else if (id != _blob_id || c.routing_id != _sender) {
+            return chunk_status::other;
+        }
+
+        if (offset != _received || c.data.size() > _size - _received) {
+            _active = false;
+            ack(c.routing_id, id, detail::blob_rejected);
+            throw std::runtime_error("blob chunk out of sequence");
+        }
+        if (c.data.size() > 0)
+            std::memcpy(static_cast<char *>(buffer.data()) + _received,
+                        c.data.data(), c.data.size());
+        _received += c.data.size();
+        ack(c.routing_id, id, _received);
+        return chunk_status::accepted;
+    }
+
+    void ack(const message_t &routing_id, uint32_t id, uint64_t received)
+    {
+        unsigned char frame[detail::blob_ack_size];
+        detail::write_network_order(frame, id);
+        detail::write_network_order(frame + 4, received);
+        _socket.send(zmq::buffer(routing_id.data(), routing_id.size()),
+                     send_flags::sndmore);
+        _socket.send(zmq::buffer(frame), send_flags::none);
+    }
+
+    socket_ref _socket;
+    std::deque<chunk> _deferred;
+    message_t _sender;
+    uint32_t _blob_id = 0;
+    size_t _size = 0;
+    size_t _received = 0;
+    bool _active = false;
+}; // class blob_receiver
+
+#if CPPZMQ_HAS_MMAP && defined(MFD_CLOEXEC)
+namespace detail
+{
+// Shared state of a shm_channel, kept alive by the received messages
+// referring to it.
+struct shm_ring
+{
+    // at the start of the shared memory, followed by the data
+    struct header
+    {
+        uint64_t capacity;
+        alignas(64) std::atomic<uint64_t> tail;
+    };
+    static ZMQ_CONSTEXPR_VAR size_t data_offset = 256;
+
+    // a received message, in order of reception
+    struct slot
+    {
+        shm_ring *ring;
+        uint64_t end;
+        bool released;
+    };
+
+    shm_ring(int fd_, size_t size, bool create) : fd(fd_), length(size)
+    {
+        void *addr =
+          ::mmap(ZMQ_NULLPTR, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            const int err = errno;
+            ::close(fd);
+            throw error_t(err);
+        }
+        base = static_cast<char *>(addr);
+        shared = reinterpret_cast<header *>(base);
+        capacity = size - data_offset;
+        if (create) {
+            shared->capacity = capacity;
+            shared->tail.store(0, std::memory_order_relaxed);
+        } else if (shared->capacity != capacity) {
+            ::munmap(base, length);
+            ::close(fd);
+            throw error_t(EINVAL);
+        }
+    }
+
+    ~shm_ring()
+    {
+        ::munmap(base, length);
+        ::close(fd);
+    }
+
+    char *data() const ZMQ_NOTHROW { return base + data_offset; }
+
+    // free_fn of received messages
+    static void release(void *, void *hint) ZMQ_NOTHROW
+    {
+        auto *s = static_cast<slot *>(hint);
+        shm_ring *ring = s->ring;
+        {
+            std::lock_guard<std::mutex> lock(ring->mutex);
+            s->released = true;
+            // slots are released in any order, but the space is reused in
+            // order of allocation
+            uint64_t tail = 0;
+            bool advanced = false;
+            while (!ring->slots.empty() && ring->slots.front().released) {
+                tail = ring->slots.front().end;
+                advanced = true;
+                ring->slots.pop_front();
+            }
+            if (advanced)
+                ring->shared->tail.store(tail, std::memory_order_release);
+        }
+        ring->unref();
+    }
+
+    void unref() ZMQ_NOTHROW
+    {
+        if (--refs == 0)
+            delete this;
+    }
+
+    int fd;
+    size_t length;
+    char *base;
+    header *shared;
+    uint64_t capacity;
+    std::atomic<size_t> refs{1};
+    std::mutex mutex;
+    // deque keeps the slots in place, they are the hints of the messages
+    std::deque<slot> slots;
+};
+} // namespace detail
+
+/*  A same-host channel passing payloads through a shared memory ring, with
+    only small descriptors going over a socket (PAIR, or PUSH/PULL with a
+    single receiver) for signalling and ordering.
+
+    One side creates the ring in an anonymous memory file, the other one
+    attaches to it by the path() of that file, e.g. after receiving it in
+    a handshake message. The producer copies payloads into the ring, or
+    writes them in place with reserve() and commit(). The consumer
+    receives message_t referring to the ring without copying; the space is
+    released, in order, once those messages are closed. The ring supports
+    one producer and one consumer.
+*/
+class shm_channel
+{
+  public:
+    // Create a ring holding capacity bytes of payloads.
+    shm_channel(socket_ref socket, size_t capacity) : _socket(socket)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("invalid shm_channel capacity");
+        const int fd = ::memfd_create("cppzmq-shm-channel", MFD_CLOEXEC);
+        if (fd < 0)
+            throw error_t(errno);
+        const size_t size = capacity + detail::shm_ring::data_offset;
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            const int err = errno;
+            ::close(fd);
+            throw error_t(err);
+        }
+        _ring = new detail::shm_ring(fd, size, true);
+    }
+
+    // Attach to a ring created by the peer, e.g. "/proc/<pid>/fd/<fd>".
+    shm_channel(socket_ref socket, const std::string &path) : _socket(socket)
+    {
+        const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+            throw error_t(errno);
+        struct stat st;
+        if (::fstat(fd, &st) != 0
+            || static_cast<size_t>(st.st_size) <= detail::shm_ring::data_offset) {
+            const int err = errno;
+            ::close(fd);
+            throw error_t(err ? err : EINVAL);
+        }
+        _ring = new detail::shm_ring(fd, static_cast<size_t>(st.st_size), false);
+    }
+
+    shm_channel(shm_channel &&rhs) ZMQ_NOTHROW
+        : _socket(rhs._socket),
+          _ring(rhs._ring),
+          _head(rhs._head),
+          _reserved(rhs._reserved),
+          _reserved_size(rhs._reserved_size),
+          _has_reservation(rhs._has_reservation)
+    {
+        rhs._ring = ZMQ_NULLPTR;
+        rhs._has_reservation = false;
+    }
+
+    shm_channel &operator=(shm_channel &&rhs) ZMQ_NOTHROW
+    {
+        std::swap(_socket, rhs._socket);
+        std::swap(_ring, rhs._ring);
+        std::swap(_head, rhs._head);
+        std::swap(_reserved, rhs._reserved);
+        std::swap(_reserved_size, rhs._reserved_size);
+        std::swap(_has_reservation, rhs._has_reservation);
+        return *this;
+    }
+
+    shm_channel(const shm_channel &) = delete;
+    shm_channel &operator=(const shm_channel &) = delete;
+
+    ~shm_channel() ZMQ_NOTHROW
+    {
+        if (_ring)
+            _ring->unref();
+    }
+
+    // Path under which the peer process can attach to the ring.
+    std::string path() const
+    {
+        return "/proc/" + std::to_string(::getpid()) + "/fd/"
+               + std::to_string(_ring->fd);
+    }
+
+    int fd() const ZMQ_NOTHROW { return _ring->fd; }
+    size_t capacity() const ZMQ_NOTHROW
+    {
+        return static_cast<size_t>(_ring->capacity);
+    }
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
+
+    /*  Reserve size contiguous bytes of the ring for the next payload,
+        to be sent by commit(). A previous reservation is dropped, also
+        when the ring has not enough free space.
+        Returns: the reserved space, with a null data() if the ring has
+        not enough free space.
+        Throws: std::length_error if size exceeds the capacity.
+    */
+    mutable_buffer reserve(size_t size)
+    {
+        const uint64_t capacity = _ring->capacity;
+        if (size > capacity)
+            throw std::length_error("payload exceeds shm_channel capacity");
+        uint64_t position = _head;
+        const uint64_t offset = position % capacity;
+        // payloads are contiguous, skip the end of the ring if needed
+        if (offset + size > capacity)
+            position += capacity - offset;
+        _has_reservation = false;
+        const uint64_t tail = _ring->shared->tail.load(std::memory_order_acquire);
+        if (position + size - tail > capacity)
+            return mutable_buffer();
+        _reserved = position;
+        _reserved_size = size;
+        _has_reservation = true;
+        return mutable_buffer(_ring->data() + position % capacity, size);
+    }
+
+    /*  Send the descriptor of the reserved payload, a reservation is sent
+        at most once.
+        Returns: the size of the payload, or nullopt (on EAGAIN), in which
+        case the reservation is kept.
+        Throws: std::runtime_error if nothing is reserved.
+    */
+    send_result_t commit(send_flags flags = send_flags::none)
+    {
+        if (!_has_reservation)
+            throw std::runtime_error("shm_channel commit without reservation");
+        unsigned char descriptor[16];
+        detail::write_network_order(descriptor, _reserved);
+        detail::write_network_order(descriptor + 8,
+                                    static_cast<uint64_t>(_reserved_size));
+        std::atomic_thread_fence(std::memory_order_release);
+        if (!_socket.send(buffer(descriptor), flags))
+            return {};
+        if (_reserved_size > 0)
+            _head = _reserved + _reserved_size;
+        _has_reservation = false;
+        return _reserved_size;
+    }
+
+    /*  Copy payload into the ring and send its descriptor.
+        Returns: the size of the payload, or nullopt if the ring is full or
+        sending the descriptor would block (EAGAIN). Never waits for space
+        in the ring.
+    */
+    send_result_t send(const_buffer payload, send_flags flags = send_flags::none)
+    {
+        const mutable_buffer space = reserve(payload.size());
+        if (space.data() == ZMQ_NULLPTR)
+            return {};
+        if (payload.size() > 0)
+            std::memcpy(space.data(), payload.data(), payload.size());
+        return commit(flags);
+    }
+
+    /*  Receive the next payload as a message referring to the ring. The
+        space is released once msg and all copies of it are closed.
+        Returns: the size of the payload, or nullopt (on EAGAIN).
+        Throws: error_t (EPROTO) if the descriptor is malformed.
+    */
+    recv_result_t recv(message_t &msg, recv_flags flags = recv_flags::none)
+    {
+        unsigned char descriptor[16];
+        const auto received = _socket.recv(buffer(descriptor), flags);
+        if (!received)
+            return {};
+        if (received->untruncated_size != sizeof(descriptor))
+            throw error_t(EPROTO);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t position = detail::read_u64_network_order(descriptor);
+        const uint64_t size = detail::read_u64_network_order(descriptor + 8);
+        const uint64_t capacity = _ring->capacity;
+        if (size > capacity || position % capacity + size > capacity)
+            throw error_t(EPROTO);
+        if (size == 0) {
+            msg.rebuild();
+            return size_t(0);
+        }
+
+        detail::shm_ring::slot *slot;
+        {
+            std::lock_guard<std::mutex> lock(_ring->mutex);
+            _ring->slots.push_back({_ring, position + size, false});
+            slot = &_ring->slots.back();
+        }
+        ++_ring->refs;
+        try {
+            msg.rebuild(_ring->data() + position % capacity,
+                        static_cast<size_t>(size), &detail::shm_ring::release,
+                        slot);
+        }
+        catch (...) {
+            detail::shm_ring::release(ZMQ_NULLPTR, slot);
+            throw;
+        }
+        return static_cast<size_t>(size);
+    }
+
+  private:
+    socket_ref _socket;
+    detail::shm_ring *_ring;
+    // producer state
+    uint64_t _head = 0;
+    uint64_t _reserved = 0;
+    size_t _reserved_size = 0;
+    bool _has_reservation = false;
+}; // class shm_channel
+#endif // CPPZMQ_HAS_MMAP && defined(MFD_CLOEXEC)
+
+
+#endif
+
+
+#ifdef ZMQ_HAS_RVALUE_REFS
+
+/*
+    This class handles multipart messaging. It is the C++ equivalent of zmsg.h,
+    which is part of CZMQ (the high-level C binding). Furthermore, it is a major
+    improvement compared to zmsg.hpp, which is part of the examples in the ØMQ
+    Guide. Unnecessary copying is avoided by using move semantics to efficiently
+    add/remove parts.
+*/
+class multipart_t
+{
+  private:
+    std::deque<message_t> m_parts;
+
+    template<class Sink> void dump(Sink &sink) const
+    {
+        for (size_t i = 0; i < m_parts.size(); i++) {
+            const unsigned char *data = m_parts[i].data<unsigned char>();
+            size_t size = m_parts[i].size();
+
+            sink.append("\n[", 2);
+            detail::dump_size(sink, size);
+            sink.append("] ", 2);
+            if (size >= 1000) {
+                static const char elided[] = "... (too big to print)";
+                sink.append(elided, sizeof(elided) - 1);
+                continue;
+            }
+
+            // Dump the message as text or binary
+            bool isText = true;
+            for (size_t j = 0; j < size; j++) {
+                if (data[j] < 32 || data[j] > 127) {
+                    isText = false;
+                    break;
+                }
+            }
+            if (isText) {
+                sink.append(reinterpret_cast<const char *>(data), size);
+            } else {
+                static const detail::dump_table table(false, false);
+                char buf[256];
+                for (size_t j = 0; j < size;) {
+                    const size_t n = (std::min)(size - j, sizeof(buf) / 2);
+                    for (size_t k = 0; k < n; ++k, ++j) {
+                        buf[2 * k] = table.chars[data[j]][0];
+                        buf[2 * k + 1] = table.chars[data[j]][1];
+                    }
+                    sink.append(buf, 2 * n);
+                }
+            }
+        }
+    }
+
+  public:
+    typedef std::deque<message_t>::value_type value_type;
+
+    typedef std::deque<message_t>::iterator iterator;
+    typedef std::deque<message_t>::const_iterator const_iterator;
+
+    typedef std::deque<message_t>::reverse_iterator reverse_iterator;
+    typedef std::deque<message_t>::const_reverse_iterator const_reverse_iterator;
+
+    // Default constructor
+    multipart_t() {}
+
+    // Construct from socket receive
+    multipart_t(socket_ref socket) { recv(socket); }
+
+    // Construct from memory block
+    multipart_t(const void *src, size_t size) { addmem(src, size); }
+
+    // Construct from string
+    multipart_t(const std::string &string) { addstr(string); }
+
+    // Construct from message part
+    multipart_t(message_t &&message) { add(std::move(message)); }
+
+    // Move constructor
+    multipart_t(multipart_t &&other) ZMQ_NOTHROW
+    {
+        m_parts = std::move(other.m_parts);
+    }
+
+    // Move assignment operator
+    multipart_t &operator=(multipart_t &&other) ZMQ_NOTHROW
+    {
+        m_parts = std::move(other.m_parts);
+        return *this;
+    }
+
+    // Destructor
+    virtual ~multipart_t() { clear(); }
+
+    message_t &operator[](size_t n) { return m_parts[n]; }
+
+    const message_t &operator[](size_t n) const { return m_parts[n]; }
+
+    message_t &at(size_t n) { return m_parts.at(n); }
+
+    const message_t &at(size_t n) const { return m_parts.at(n); }
+
+    iterator begin() { return m_parts.begin(); }
+
+    const_iterator begin() const { return m_parts.begin(); }
+
+    const_iterator cbegin() const { return m_parts.cbegin(); }
+
+    reverse_iterator rbegin() { return m_parts.rbegin(); }
+
+    const_reverse_iterator rbegin() const { return m_parts.rbegin(); }
+
+    iterator end() { return m_parts.end(); }
+
+    const_iterator end() const { return m_parts.end(); }
+
+    const_iterator cend() const { return m_parts.cend(); }
+
+    reverse_iterator rend() { return m_parts.rend(); }
+
+    const_reverse_iterator rend() const { return m_parts.rend(); }
+
+    // Delete all parts
+    void clear() { m_parts.clear(); }
+
+    // Get number of parts
+    size_t size() const { return m_parts.size(); }
+
+    // Check if number of parts is zero
+    bool empty() const { return m_parts.empty(); }
+
+    // Receive multipart message from socket
+    bool recv(socket_ref socket, int flags = 0)
+    {
+        clear();
+        bool more = true;
+        while (more) {
+            message_t message;
+#ifdef ZMQ_CPP11
+            if (!socket.recv(message, static_cast<recv_flags>(flags)))
+                return false;
+#else
+            if (!socket.recv(&message, flags))
+                return false;
+#endif
+            more = message.more();
+            add(std::move(message));
+        }
+        return true;
+    }
+
+    // Send multipart message to socket
+    bool send(socket_ref socket, int flags = 0)
+    {
+        flags &= ~(ZMQ_SNDMORE);
+        bool more = size() > 0;
+        while (more) {
+            message_t message = pop();
+            more = size() > 0;
+#ifdef ZMQ_CPP11
+            if (!socket.send(message, static_cast<send_flags>(
+                                        (more ? ZMQ_SNDMORE : 0) | flags)))
+                return false;
+#else
+            if (!socket.send(message, (more ? ZMQ_SNDMORE : 0) | flags))
+                return false;
+#endif
+        }
+        clear();
+        return true;
+    }
+
+    // Concatenate other multipart to front
+    void prepend(multipart_t &&other)
+    {
+        while (!other.empty())
+            push(other.remove());
+    }
+
+    // Concatenate other multipart to back
+    void append(multipart_t &&other)
+    {
+        while (!other.empty())
+            add(other.pop());
+    }
+
+    // Push memory block to front
+    void pushmem(const void *src, size_t size)
+    {
+        m_parts.push_front(message_t(src, size));
+    }
+
+    // Push memory block to back
+    void addmem(const void *src, size_t size)
+    {
+        m_parts.push_back(message_t(src, size));
+    }
+
+    // Push string to front
+    void pushstr(const std::string &string)
+    {
+        m_parts.push_front(message_t(string.data(), string.size()));
+    }
+
+    // Push string to back
+    void addstr(const std::string &string)
+    {
+        m_parts.push_back(message_t(string.data(), string.size()));
+    }
+
+    // Push type (fixed-size) to front
+    template<typename T> void pushtyp(const T &type)
+    {
+        static_assert(!std::is_same<T, std::string>::value,
+                      "Use pushstr() instead of pushtyp<std::string>()");
+        m_parts.push_front(message_t(&type, sizeof(type)));
+    }
+
+    // Push type (fixed-size) to back
+    template<typename T> void addtyp(const T &type)
+    {
+        static_assert(!std::is_same<T, std::string>::value,
+                      "Use addstr() instead of addtyp<std::string>()");
+        m_parts.push_back(message_t(&type, sizeof(type)));
+    }
+
+    // Push message part to front
+    void push(message_t &&message) { m_parts.push_front(std::move(message)); }
+
+    // Push message part to back
+    void add(message_t &&message) { m_parts.push_back(std::move(message)); }
+
+    // Alias to allow std::back_inserter()
+    void push_back(message_t &&message) { m_parts.push_back(std::move(message)); }
+
+    // Pop string from front
+    std::string popstr()
+    {
+        std::string string(m_parts.front().data<char>(), m_parts.front().size());
+        m_parts.pop_front();
+        return string;
+    }
+
+    // Pop type (fixed-size) from front
+    template<typename T> T poptyp()
+    {
+        static_assert(!std::is_same<T, std::string>::value,
+                      "Use popstr() instead of poptyp<std::string>()");
+        if (sizeof(T) != m_parts.front().size())
+            throw std::runtime_error(
+              "Invalid type, size does not match the message size");
+        T type = *m_parts.front().data<T>();
+        m_parts.pop_front();
+        return type;
+    }
+
+    // Pop message part from front
+    message_t pop()
+    {
+        message_t message = std::move(m_parts.front());
+        m_parts.pop_front();
+        return message;
+    }
+
+    // Pop message part from back
+    message_t remove()
+    {
+        message_t message = std::move(m_parts.back());
+        m_parts.pop_back();
+        return message;
+    }
+
+    // get message part from front
+    const message_t &front() { return m_parts.front(); }
+
+    // get message part from back
+    const message_t &back() { return m_parts.back(); }
+
+    // Get pointer to a specific message part
+    const message_t *peek(size_t index) const { return &m_parts[index]; }
+
+    // Get a string copy of a specific message part
+    std::string peekstr(size_t index) const
+    {
+        std::string string(m_parts[index].data<char>(), m_parts[index].size());
+        return string;
+    }
+
+    // Peek type (fixed-size) from front
+    template<typename T> T peektyp(size_t index) const
+    {
+        static_assert(!std::is_same<T, std::string>::value,
+                      "Use peekstr() instead of peektyp<std::string>()");
+        if (sizeof(T) != m_parts[index].size())
+            throw std::runtime_error(
+              "Invalid type, size does not match the message size");
+        T type = *m_parts[index].data<T>();
+        return type;
+    }
+
+    // Create multipart from type (fixed-size)
+    template<typename T> static multipart_t create(const T &type)
+    {
+        multipart_t multipart;
+        multipart.addtyp(type);
+        return multipart;
+    }
+
+    // Copy multipart
+    multipart_t clone() const
+    {
+        multipart_t multipart;
+        for (size_t i = 0; i < size(); i++)
+            multipart.addmem(m_parts[i].data(), m_parts[i].size());
+        return multipart;
+    }
+
+    // Dump content to string
+    std::string str() const
+    {
+        std::string out;
+        str(out);
+        return out;
+    }
+
+    // Dump content into out, replacing its contents
+    void str(std::string &out) const
+    {
+        out.clear();
+        detail::string_sink sink(out);
+        dump(sink);
+    }
+
+    // Dump content into buf, NUL-terminated and cut short if it does not
+    // fit. Returns the length of the whole dump, as snprintf does.
+    size_t str(char *buf, size_t buf_size) const
+    {
+        detail::buffer_sink sink(buf, buf_size);
+        dump(sink);
+        return sink.finish();
+    }
+
+    // Check if equal to other multipart
+    bool equal(const multipart_t *other) const ZMQ_NOTHROW
+    {
+        return *this == *other;
+    }
+
+    bool operator==(const multipart_t &other) const ZMQ_NOTHROW
+    {
+        if (size() != other.size())
+            return false;
+        for (size_t i = 0; i < size(); i++)
+            if (at(i) != other.at(i))
+                return false;
+        return true;
+    }
+
+    bool operator!=(const multipart_t &other) const ZMQ_NOTHROW
+    {
+        return !(*this == other);
+    }
+
+#ifdef ZMQ_CPP11
+
+    // Return single part message_t encoded from this multipart_t.
+    message_t encode() const { return zmq::encode(*this); }
+
+    // Decode encoded message into multiple parts and append to self.
+    void decode_append(const message_t &encoded)
+    {
+        zmq::decode(encoded, std::back_inserter(*this));
+    }
+
+    // Return a new multipart_t containing the decoded message_t.
+    static multipart_t decode(const message_t &encoded)
+    {
+        multipart_t tmp;
+        zmq::decode(encoded, std::back_inserter(tmp));
+        return tmp;
+    }
+
+#endif
+
+  private:
+    // Disable implicit copying (moving is more efficient)
+    multipart_t(const multipart_t &other) ZMQ_DELETED_FUNCTION;
+    void operator=(const multipart_t &other) ZMQ_DELETED_FUNCTION;
+}; // class multipart_t
+
+inline std::ostream &operator<<(std::ostream &os, const multipart_t &msg)
+{
+    return os << msg.str();
+}
+
+#endif // ZMQ_HAS_RVALUE_REFS
+
+#ifdef ZMQ_CPP11
+
+namespace detail
+{
+// smallest power of two not below capacity, and at least 2
+inline size_t ring_capacity(size_t capacity)
+{
+    size_t n = 2;
+    while (n < capacity)
+        n <<= 1;
+    return n;
+}
+
+// keeps the indices of producers and consumers on separate cache lines
+struct padded_index
+{
+    std::atomic<size_t> value{0};
+    char padding[64 - sizeof(std::atomic<size_t>)];
+};
+
+/*  Bounded lock-free queue after Dmitry Vyukov's MPMC ring. Each cell
+    carries a sequence number telling producers and consumers whose turn
+    it is, so neither side takes a lock and a full queue is reported to
+    the producer instead of blocking it. The capacity is rounded up to a
+    power of two.
+*/
+template<class T> class mpmc_ring
+{
+  public:
+    explicit mpmc_ring(size_t capacity) :
+        _mask(ring_capacity(capacity) - 1), _cells(new cell[_mask + 1])
+    {
+        for (size_t i = 0; i <= _mask; ++i)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    mpmc_ring(const mpmc_ring &) = delete;
+    mpmc_ring &operator=(const mpmc_ring &) = delete;
+
+    // value is left untouched when the ring is full
+    bool try_push(T &&value)
+    {
+        cell *c;
+        size_t pos = _enqueue.value.load(std::memory_order_relaxed);
+        for (;;) {
+            c = &_cells[pos & _mask];
+            const size_t seq = c->sequence.load(std::memory_order_acquire);
+            const auto diff =
+              static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (_enqueue.value.compare_exchange_weak(
+                      pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _enqueue.value.load(std::memory_order_relaxed);
+            }
+        }
+        c->value = std::move(value);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value)
+    {
+        cell *c;
+        size_t pos = _dequeue.value.load(std::memory_order_relaxed);
+        for (;;) {
+            c = &_cells[pos & _mask];
+            const size_t seq = c->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq)
+                              - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (_dequeue.value.compare_exchange_weak(
+                      pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _dequeue.value.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(c->value);
+        c->value = T();
+        c->sequence.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const ZMQ_NOTHROW { return _mask + 1; }
+
+    // a snapshot only, other threads may change it at any time
+    size_t size() const ZMQ_NOTHROW
+    {
+        const size_t tail = _dequeue.value.load(std::memory_order_acquire);
+        const size_t head = _enqueue.value.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+  private:
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t _mask;
+    std::unique_ptr<cell[]> _cells;
+    padded_index _enqueue;
+    padded_index _dequeue;
+};
+
+/*  Bounded wait-free queue between exactly one producer and one consumer
+    thread. Each side owns its index and caches the other one, so the
+    shared cache lines are only read when the ring looks full or empty.
+    The capacity is rounded up to a power of two.
+*/
+template<class T> class spsc_ring
+{
+  public:
+    explicit spsc_ring(size_t capacity) :
+        _mask(ring_capacity(capacity) - 1), _cells(new T[_mask + 1])
+    {
+    }
+
+    spsc_ring(const spsc_ring &) = delete;
+    spsc_ring &operator=(const spsc_ring &) = delete;
+
+    // producer only, value is left untouched when the ring is full
+    bool try_push(T &&value)
+    {
+        const size_t head = _head.value.load(std::memory_order_relaxed);
+        if (head - _head.cache > _mask) {
+            _head.cache = _tail.value.load(std::memory_order_acquire);
+            if (head - _head.cache > _mask)
+                return false;
+        }
+        _cells[head & _mask] = std::move(value);
+        _head.value.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, the oldest element or nullptr if the ring is empty
+    T *front()
+    {
+        const size_t tail = _tail.value.load(std::memory_order_relaxed);
+        if (tail == _tail.cache) {
+            _tail.cache = _head.value.load(std::memory_order_acquire);
+            if (tail == _tail.cache)
+                return ZMQ_NULLPTR;
+        }
+        return &_cells[tail & _mask];
+    }
+
+    // consumer only, removes the element returned by front()
+    void pop()
+    {
+        const size_t tail = _tail.value.load(std::memory_order_relaxed);
+        _cells[tail & _mask] = T();
+        _tail.value.store(tail + 1, std::memory_order_release);
+    }
+
+    size_t capacity() const ZMQ_NOTHROW { return _mask + 1; }
+
+    // a snapshot only, other threads may change it at any time
+    size_t size() const ZMQ_NOTHROW
+    {
+        const size_t tail = _tail.value.load(std::memory_order_acquire);
+        const size_t head = _head.value.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+  private:
+    // an index together with its owner's cached copy of the other index
+    struct side
+    {
+        std::atomic<size_t> value{0};
+        size_t cache = 0;
+        char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    };
+
+    const size_t _mask;
+    std::unique_ptr<T[]> _cells;
+    side _head;
+    side _tail;
+};
+} // namespace detail
+
+/*  A hierarchical timer wheel, an in-process alternative to zmq::timers.
+
+    Timers are kept in four levels of 256 slots each, every slot being an
+    intrusive list of timer nodes, so add(), cancel(), set_interval() and
+    reset() are O(1) and do not allocate once the node pool is warm.
+    The wheel ticks at the given resolution (one microsecond by default)
+    and covers 2^32 ticks directly; timers further out are parked in an
+    overflow list and re-inserted as the wheel turns.
+
+    Like zmq::timers, every timer repeats with its interval until it is
+    cancelled, and handlers run from execute() on the calling thread.
+    timeout() returns the time until the next timer is due, rounded up to
+    whole milliseconds so that it can be passed to poller_t::wait as-is:
+
+        auto timeout = wheel.timeout();
+        poller.wait(events, timeout ? *timeout : std::chrono::milliseconds{-1});
+        wheel.execute();
+
+    The returned timeout may be shorter than the actual deadline for timers
+    far in the future; execute() then only moves them closer to level 0.
+*/
+class timer_wheel
+{
+  public:
+    using id_t = std::uint64_t;
+    using handler_type = std::function<void(id_t)>;
+    using clock = std::chrono::steady_clock;
+
+#if CPPZMQ_HAS_OPTIONAL
+    using timeout_result_t = std::optional<std::chrono::milliseconds>;
+#else
+    using timeout_result_t = detail::trivial_optional<std::chrono::milliseconds>;
+#endif
+
+    explicit timer_wheel(
+      std::chrono::microseconds resolution = std::chrono::microseconds{1}) :
+        _resolution(resolution), _origin(clock::now())
+    {
+        if (resolution.count() <= 0)
+            throw std::invalid_argument("Invalid timer_wheel resolution");
+        _heads.fill(std::uint32_t{nil});
+        _occupied.fill(0);
+    }
+
+    timer_wheel(const timer_wheel &) = delete;
+    timer_wheel &operator=(const timer_wheel &) = delete;
+
+    /*  Add a timer calling handler every interval, starting one interval
+        from now. Intervals are rounded up to the wheel resolution.
+    */
+    id_t add(std::chrono::microseconds interval, handler_type handler)
+    {
+        if (interval.count() < 0 || !handler)
+            throw error_t(EINVAL);
+
+        std::uint32_t index;
+        if (_free.empty()) {
+            if (_nodes.size() >= nil)
+                throw std::length_error("timer_wheel capacity exceeded");
+            index = static_cast<std::uint32_t>(_nodes.size());
+            _nodes.emplace_back();
+        } else {
+            index = _free.back();
+            _free.pop_back();
+        }
+
+        node &n = _nodes[index];
+        n.handler = std::move(handler);
+        n.interval = to_ticks(interval);
+        n.expiry = now_tick() + n.interval;
+        n.active = true;
+        insert(index);
+        ++_size;
+        return make_id(index, n.generation);
+    }
+
+    void cancel(id_t timer_id)
+    {
+        const std::uint32_t index = lookup(timer_id);
+        node &n = _nodes[index];
+        if (n.list != nil)
+            unlink(index);
+        n.active = false;
+        --_size;
+        // a handler cancelling itself is released once it has returned
+        if (index != _running)
+            release(index);
+    }
+
+    /*  Change the interval of a timer and restart it from now.
+    */
+    void set_interval(id_t timer_id, std::chrono::microseconds interval)
+    {
+        if (interval.count() < 0)
+            throw error_t(EINVAL);
+        const std::uint32_t index = lookup(timer_id);
+        _nodes[index].interval = to_ticks(interval);
+        reschedule(index, now_tick());
+    }
+
+    /*  Restart a timer so that it is next due one interval from now.
+    */
+    void reset(id_t timer_id) { reschedule(lookup(timer_id), now_tick()); }
+
+    timeout_result_t timeout() const
+    {
+        if (_size == 0)
+            return timeout_result_t{};
+
+        const std::uint64_t now = now_tick();
+        std::uint64_t due = _tick;
+        if (_heads[slot_list(0, _tick)] == nil)
+            due = next_event();
+        if (due <= now)
+            return std::chrono::milliseconds{0};
+
+        const auto remaining = (due - now) * _resolution.count();
+        return std::chrono::milliseconds{
+          static_cast<std::chrono::milliseconds::rep>((remaining + 999) / 1000)};
+    }
+
+    /*  Run the handlers of all timers that are due. Handlers may add, cancel
+        and reset timers, including their own.
+    */
+    void execute()
+    {
+        const std::uint64_t target = now_tick();
+        if (_size == 0) {
+            _tick = target > _tick ? target : _tick;
+            return;
+        }
+
+        run_slot(target);
+        for (;;) {
+            const std::uint64_t next = next_event();
+            if (next > target)
+                break;
+            _tick = next;
+            cascade();
+            run_slot(target);
+        }
+        _tick = target > _tick ? target : _tick;
+    }
+
+    size_t size() const ZMQ_NOTHROW { return _size; }
+    bool empty() const ZMQ_NOTHROW { return _size == 0; }
+    std::chrono::microseconds resolution() const ZMQ_NOTHROW { return _resolution; }
+
+  private:
+    static ZMQ_CONSTEXPR_VAR unsigned slot_bits = 8;
+    static ZMQ_CONSTEXPR_VAR unsigned slot_count = 1u << slot_bits;
+    static ZMQ_CONSTEXPR_VAR std::uint64_t slot_mask = slot_count - 1;
+    static ZMQ_CONSTEXPR_VAR unsigned level_count = 4;
+    static ZMQ_CONSTEXPR_VAR unsigned overflow = level_count * slot_count;
+    static ZMQ_CONSTEXPR_VAR std::uint32_t nil = 0xffffffff;
+
+    struct node
+    {
+        std::uint64_t expiry = 0;
+        std::uint64_t interval = 0;
+        std::uint32_t prev = nil;
+        std::uint32_t next = nil;
+        std::uint32_t list = nil;
+        std::uint32_t generation = 0;
+        bool active = false;
+        handler_type handler;
+    };
+
+    static id_t make_id(std::uint32_t index, std::uint32_t generation) ZMQ_NOTHROW
+    {
+        return (static_cast<id_t>(generation) << 32) | index;
+    }
+
+    static std::uint32_t slot_list(unsigned level, std::uint64_t tick) ZMQ_NOTHROW
+    {
+        return static_cast<std::uint32_t>(
+          level * slot_count + ((tick >> (level * slot_bits)) & slot_mask));
+    }
+
+    static unsigned lowest_bit(std::uint64_t v) ZMQ_NOTHROW
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(v));
+#else
+        unsigned n = 0;
+        while (!(v & 1)) {
+            v >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    std::uint64_t to_ticks(std::chrono::microseconds interval) const
+    {
+        const auto ticks = (interval.count() + _resolution.count() - 1)
+                           / _resolution.count();
+        return ticks > 0 ? static_cast<std::uint64_t>(ticks) : 1;
+    }
+
+    std::uint64_t now_tick() const
+    {
+        return static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(clock::now()
+                                                                - _origin)
+            .count()
+          / _resolution.count());
+    }
+
+    std::uint32_t lookup(id_t timer_id) const
+    {
+        const auto index = static_cast<std::uint32_t>(timer_id & 0xffffffff);
+        const auto generation = static_cast<std::uint32_t>(timer_id >> 32);
+        if (index >= _nodes.size() || !_nodes[index].active
+            || _nodes[index].generation != generation)
+            throw error_t(EINVAL);
+        return index;
+    }
+
+    void release(std::uint32_t index)
+    {
+        node &n = _nodes[index];
+        n.handler = nullptr;
+        ++n.generation;
+        _free.push_back(index);
+    }
+
+    void reschedule(std::uint32_t index, std::uint64_t now)
+    {
+        node &n = _nodes[index];
+        if (n.list != nil)
+            unlink(index);
+        n.expiry = now + n.interval;
+        insert(index);
+    }
+
+    // Place a node on the level where its expiry first differs from the
+    // current tick; expired nodes go into the current level 0 slot.
+    void insert(std::uint32_t index)
+    {
+        node &n = _nodes[index];
+        const std::uint64_t expiry = n.expiry > _tick ? n.expiry : _tick;
+        unsigned level = 0;
+        for (std::uint64_t diff = (expiry ^ _tick) >> slot_bits; diff != 0;
+             diff >>= slot_bits)
+            ++level;
+
+        const std::uint32_t list =
+          level < level_count ? slot_list(level, expiry) : overflow;
+        n.list = list;
+        n.prev = nil;
+        n.next = _heads[list];
+        if (n.next != nil)
+            _nodes[n.next].prev = index;
+        _heads[list] = index;
+        if (list != overflow)
+            _occupied[list / 64] |= std::uint64_t{1} << (list % 64);
+    }
+
+    void unlink(std::uint32_t index)
+    {
+        node &n = _nodes[index];
+        if (n.prev != nil)
+            _nodes[n.prev].next = n.next;
+        else
+            _heads[n.list] = n.next;
+        if (n.next != nil)
+            _nodes[n.next].prev = n.prev;
+        if (_heads[n.list] == nil && n.list != overflow)
+            _occupied[n.list / 64] &= ~(std::uint64_t{1} << (n.list % 64));
+        n.prev = n.next = n.list = nil;
+    }
+
+    // First occupied slot of a level at or after from, or slot_count.
+    unsigned find_slot(unsigned level, unsigned from) const ZMQ_NOTHROW
+    {
+        const unsigned base = level * slot_count;
+        for (unsigned word = from / 64; word < slot_count / 64; ++word) {
+            std::uint64_t bits = _occupied[(base / 64) + word];
+            if (word == from / 64)
+                bits &= ~std::uint64_t{0} << (from % 64);
+            if (bits != 0)
+                return word * 64 + lowest_bit(bits);
+        }
+        return slot_count;
+    }
+
+    // The next tick after the current one at which a level 0 slot has to
+    // run or a higher level slot has to be cascaded.
+    std::uint64_t next_event() const ZMQ_NOTHROW
+    {
+        for (unsigned level = 0; level < level_count; ++level) {
+            const unsigned shift = level * slot_bits;
+            const auto digit = static_cast<unsigned>((_tick >> shift) & slot_mask);
+            const unsigned slot = find_slot(level, digit + 1);
+            if (slot < slot_count)
+                return ((_tick >> (shift + slot_bits)) << (shift + slot_bits))
+                       | (static_cast<std::uint64_t>(slot) << shift);
+        }
+        if (_heads[overflow] != nil) {
+            const unsigned shift = level_count * slot_bits;
+            return ((_tick >> shift) + 1) << shift;
+        }
+        return (std::numeric_limits<std::uint64_t>::max)();
+    }
+
+    // Re-insert the slots whose range begins at the current tick, highest
+    // level first, so their nodes trickle down towards level 0.
+    void cascade()
+    {
+        unsigned levels = 0;
+        while (levels < level_count
+               && (_tick & ((std::uint64_t{1} << ((levels + 1) * slot_bits)) - 1))
+                    == 0)
+            ++levels;
+
+        if (levels == level_count)
+            reinsert(overflow);
+        for (unsigned level = levels < level_count ? levels : level_count - 1;
+             level > 0; --level)
+            reinsert(slot_list(level, _tick));
+    }
+
+    void reinsert(std::uint32_t list)
+    {
+        std::uint32_t index = _heads[list];
+        while (index != nil) {
+            const std::uint32_t next = _nodes[index].next;
+            unlink(index);
+            insert(index);
+            index = next;
+        }
+    }
+
+    void run_slot(std::uint64_t now)
+    {
+        const std::uint32_t list = slot_list(0, _tick);
+        std::uint32_t index;
+        while ((index = _heads[list]) != nil) {
+            unlink(index);
+            const id_t timer_id = make_id(index, _nodes[index].generation);
+
+            _running = index;
+            try {
+                _nodes[index].handler(timer_id);
+            }
+            catch (...) {
+                _running = nil;
+                finish(index, now);
+                throw;
+            }
+            _running = nil;
+            finish(index, now);
+        }
+    }
+
+    void finish(std::uint32_t index, std::uint64_t now)
+    {
+        node &n = _nodes[index];
+        if (!n.active)
+            release(index);
+        else if (n.list == nil)
+            reschedule(index, now);
+    }
+
+    std::chrono::microseconds _resolution;
+    clock::time_point _origin;
+    std::uint64_t _tick = 0;
+    size_t _size = 0;
+    std::uint32_t _running = nil;
+    std::deque<node> _nodes;
+    std::vector<std::uint32_t> _free;
+    std::array<std::uint32_t, level_count * slot_count + 1> _heads;
+    std::array<std::uint64_t, level_count * slot_count / 64> _occupied;
+};
+
+/*  Lets many threads send through one socket. Producers hand single-part
+    messages to a bounded lock-free ring with try_send(), which reports
+    backpressure by returning false when the ring is full; the thread
+    owning the socket moves them onto the wire with flush():
+
+        while (running) {
+            sender.wait(std::chrono::milliseconds{100});
+            sender.flush();
+        }
+
+    try_send() and rejected() are thread-safe, everything else belongs to the
+    owner thread. The socket must outlive this object. Multipart messages
+    can be sent as one part with zmq::encode.
+*/
+class shared_sender
+{
+  public:
+    explicit shared_sender(socket_ref socket, size_t capacity = 4096) :
+        _socket(socket), _queue(capacity)
+    {
+    }
+
+    shared_sender(const shared_sender &) = delete;
+    shared_sender &operator=(const shared_sender &) = delete;
+
+    /*  Queue a message for sending. Thread-safe.
+        Returns: false if the ring is full, msg is then left untouched.
+    */
+    bool try_send(message_t &&msg)
+    {
+        if (!_queue.try_push(std::move(msg))) {
+            _rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // pairs with the fence in wait(), so a sleeping owner is not missed
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _ready.notify_one();
+        }
+        return true;
+    }
+
+    /*  Block until messages are queued or the timeout expires.
+        Returns: true if messages are queued.
+    */
+    bool wait(std::chrono::milliseconds timeout)
+    {
+        if (_has_pending || _queue.size() > 0)
+            return true;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool ready =
+          _ready.wait_for(lock, timeout, [this] { return _queue.size() > 0; });
+        _waiting.store(false, std::memory_order_relaxed);
+        return ready;
+    }
+
+    /*  Send queued messages until the ring is empty, a send would block
+        (with send_flags::dontwait) or capacity() messages have been sent.
+        A message that could not be sent is retried first on the next call.
+        Returns: the number of messages sent.
+        Throws: error_t if sending fails for another reason.
+    */
+    size_t flush(send_flags flags = send_flags::dontwait)
+    {
+        size_t sent = 0;
+        while (sent < _queue.capacity()) {
+            if (!_has_pending) {
+                if (!_queue.try_pop(_pending))
+                    break;
+                _has_pending = true;
+            }
+            if (!_socket.send(_pending, flags))
+                break;
+            _has_pending = false;
+            ++sent;
+        }
+        _sent += sent;
+        return sent;
+    }
+
+    // queued messages, a snapshot only
+    size_t size() const ZMQ_NOTHROW
+    {
+        return _queue.size() + (_has_pending ? 1 : 0);
+    }
+    size_t capacity() const ZMQ_NOTHROW { return _queue.capacity(); }
+
+    // messages sent so far
+    size_t sent() const ZMQ_NOTHROW { return _sent; }
+
+    // messages try_send() turned away because the ring was full
+    size_t rejected() const ZMQ_NOTHROW
+    {
+        return _rejected.load(std::memory_order_relaxed);
+    }
+
+    socket_ref socket() const ZMQ_NOTHROW { return _socket; }
+
+  private:
+    socket_ref _socket;
+    detail::mpmc_ring<message_t> _queue;
+    message_t _pending;
+    bool _has_pending = false;
+    size_t _sent = 0;
+    std::atomic<size_t> _rejected{0};
+    std::atomic<bool> _waiting{false};
+    std::mutex _mutex;
+    std::condition_variable _ready;
+}; // class shared_sender
+
+/*  Publishes topic and payload pairs from many threads on one PUB (or
+    XPUB) socket without an inproc XSUB/XPUB proxy hop. Every producing
+    thread gets its own producer with a wait-free single-producer ring;
+    the thread owning the hub drains all rings round-robin in batches:
+
+        auto &producer = hub.make_producer(); // on each producing thread
+        producer.try_publish(std::move(topic), std::move(payload));
+
+        while (running) {                     // on the owning thread
+            hub.wait(std::chrono::milliseconds{100});
+            hub.flush();
+        }
+
+    make_producer() and the producers' try_publish() are thread-safe, with
+    each producer used by a single thread at a time; everything else
+    belongs to the owner thread. Producers live as long as the hub.
+*/
+class publisher_hub
+{
+    struct publication
+    {
+        message_t topic;
+        message_t payload;
+    };
+
+  public:
+    class producer
+    {
+      public:
+        producer(const producer &) = delete;
+        producer &operator=(const producer &) = delete;
+
+        /*  Queue a two-part message.
+            Returns: false if this producer's ring is full, topic and
+            payload are then left untouched.
+        */
+        bool try_publish(message_t &&topic, message_t &&payload)
+        {
+            publication p{std::move(topic), std::move(payload)};
+            if (!_ring.try_push(std::move(p))) {
+                topic = std::move(p.topic);
+                payload = std::move(p.payload);
+                return false;
+            }
+            _hub.notify();
+            return true;
+        }
+
+        bool try_publish(const_buffer topic, const_buffer payload)
+        {
+            message_t t(topic.data(), topic.size());
+            message_t p(payload.data(), payload.size());
+            return try_publish(std::move(t), std::move(p));
+        }
+
+      private:
+        friend class publisher_hub;
+
+        producer(publisher_hub &hub, size_t capacity) :
+            _hub(hub), _ring(capacity)
+        {
+        }
+
+        publisher_hub &_hub;
+        detail::spsc_ring<publication> _ring;
+    };
+
+    explicit publisher_hub(socket_t &&socket,
+                           size_t ring_capacity = 1024,
+                           size_t max_producers = 64) :
+        _socket(std::move(socket)),
+        _ring_capacity(ring_capacity),
+        _producers(new std::unique_ptr<producer>[max_producers]),
+        _max_producers(max_producers)
+    {
+    }
+
+    publisher_hub(const publisher_hub &) = delete;
+    publisher_hub &operator=(const publisher_hub &) = delete;
+
+    /*  Create a producer for the calling thread. Thread-safe.
+        Throws: std::length_error if max_producers have been created.
+    */
+    producer &make_producer()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const size_t index = _producer_count.load(std::memory_order_relaxed);
+        if (index == _max_producers)
+            throw std::length_error("publisher_hub producer limit reached");
+        _producers[index].reset(new producer(*this, _ring_capacity));
+        _producer_count.store(index + 1, std::memory_order_release);
+        return *_producers[index];
+    }
+
+    /*  Block until a producer has queued messages or the timeout expires.
+        Returns: true if messages are queued.
+    */
+    bool wait(std::chrono::milliseconds timeout)
+    {
+        if (pending())
+            return true;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool ready =
+          _ready.wait_for(lock, timeout, [this] { return pending(); });
+        _waiting.store(false, std::memory_order_relaxed);
+        return ready;
+    }
+
+    /*  Send up to batch queued messages from each producer, visiting the
+        producers round-robin, starting after the producer visited last by
+        the previous call. A message that would block stays queued.
+        Returns: the number of messages sent.
+        Throws: error_t if sending fails for another reason. If sending
+        the payload failed after its topic was queued, the payload is
+        sent first by the next call, so the frames stay paired.
+    */
+    size_t flush(size_t batch = 64)
+    {
+        size_t sent = 0;
+        if (_has_pending_payload) {
+            _socket.send(_pending_payload, send_flags::none);
+            _has_pending_payload = false;
+            ++sent;
+        }
+        bool blocked = false;
+        const size_t count = _producer_count.load(std::memory_order_acquire);
+        for (size_t visited = 0; visited < count && !blocked; ++visited) {
+            const size_t i = (_next + visited) % count;
+            auto &ring = _producers[i]->_ring;
+            for (size_t n = 0; n < batch; ++n) {
+                publication *p = ring.front();
+                if (p == ZMQ_NULLPTR)
+                    break;
+                if (!_socket.send(p->topic,
+                                  send_flags::sndmore | send_flags::dontwait)) {
+                    blocked = true;
+                    break;
+                }
+                // once the first part is queued libzmq accepts the rest
+                try {
+                    _socket.send(p->payload, send_flags::none);
+                }
+                catch (...) {
+                    _pending_payload = std::move(p->payload);
+                    _has_pending_payload = true;
+                    ring.pop();
+                    _next = (i + 1) % count;
+                    _sent += sent;
+                    throw;
+                }
+                ring.pop();
+                ++sent;
+            }
+            _next = (i + 1) % count;
+        }
+        _sent += sent;
+        return sent;
     }
 
-    // Push message part to front
-    void push(message_t &&message) { m_parts.push_front(std::move(message)); }
+    socket_ref socket() ZMQ_NOTHROW { return _socket; }
 
-    // Push message part to back
-    void add(message_t &&message) { m_parts.push_back(std::move(message)); }
+    size_t producers() const ZMQ_NOTHROW
+    {
+        return _producer_count.load(std::memory_order_acquire);
+    }
 
-    // Alias to allow std::back_inserter()
-    void push_back(message_t &&message) { m_parts.push_back(std::move(message)); }
+    // messages sent so far
+    size_t sent() const ZMQ_NOTHROW { return _sent; }
 
-    // Pop string from front
-    std::string popstr()
+  private:
+    bool pending() const
     {
-        std::string string(m_parts.front().data<char>(), m_parts.front().size());
-        m_parts.pop_front();
-        return string;
+        if (_has_pending_payload)
+            return true;
+        const size_t count = _producer_count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+            if (_producers[i]->_ring.size() > 0)
+                return true;
+        return false;
     }
 
-    // Pop type (fixed-size) from front
-    template<typename T> T poptyp()
+    void notify()
     {
-        static_assert(!std::is_same<T, std::string>::value,
-                      "Use popstr() instead of poptyp<std::string>()");
-        if (sizeof(T) != m_parts.front().size())
-            throw std::runtime_error(
-              "Invalid type, size does not match the message size");
-        T type = *m_parts.front().data<T>();
-        m_parts.pop_front();
-        return type;
+        // pairs with the fence in wait(), so a sleeping owner is not missed
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _ready.notify_one();
+        }
     }
 
-    // Pop message part from front
-    message_t pop()
+    socket_t _socket;
+    const size_t _ring_capacity;
+    std::unique_ptr<std::unique_ptr<producer>[]> _producers;
+    const size_t _max_producers;
+    std::atomic<size_t> _producer_count{0};
+    // the producer flush() visits first
+    size_t _next = 0;
+    // the payload of a publication whose topic was sent, see flush()
+    message_t _pending_payload;
+    bool _has_pending_payload = false;
+    size_t _sent = 0;
+    std::atomic<bool> _waiting{false};
+    std::mutex _mutex;
+    std::condition_variable _ready;
+}; // class publisher_hub
+
+#endif // ZMQ_CPP11
+
+#if defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
+/*  A poller caching the readiness of its sockets, for pollers with many
+    sockets of which few are active at a time.
+
+    poller_t asks every registered socket for its events on every wait.
+    cached_poller_t instead watches the notification descriptor of each
+    socket (sockopt::fd) and only queries the sockets whose descriptor
+    fired, the sockets reported by the previous wait and the sockets
+    passed to touch() or modify() since. With epoll (Linux) a wait thus
+    takes time proportional to the active sockets; elsewhere a poller_t
+    over the descriptors is used, which still saves the queries.
+
+    The descriptor only signals state changes libzmq has not processed
+    yet, so an operation on a socket may change its readiness silently.
+    Sockets reported by a wait are rechecked by the next one anyway; after
+    sending or receiving on any other registered socket, call touch() on
+    it. Only sockets can be added, thread-safe sockets are not supported
+    as they have no notification descriptor. Events are reported in a
+    rotating order, so a full event buffer does not starve any socket.
+*/
+template<typename T = no_user_data> class cached_poller_t
+{
+  public:
+    using event_type = poller_event<T>;
+
+    cached_poller_t()
     {
-        message_t message = std::move(m_parts.front());
-        m_parts.pop_front();
-        return message;
+#if CPPZMQ_HAS_EPOLL
+        _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (_epoll_fd == -1)
+            throw error_t();
+#endif
     }
 
-    // Pop message part from back
-    message_t remove()
+    ~cached_poller_t()
     {
-        message_t message = std::move(m_parts.back());
-        m_parts.pop_back();
-        return message;
+#if CPPZMQ_HAS_EPOLL
+        ::close(_epoll_fd);
+#endif
     }
 
-    // get message part from front
-    const message_t &front() { return m_parts.front(); }
-
-    // get message part from back
-    const message_t &back() { return m_parts.back(); }
+    cached_poller_t(const cached_poller_t &) = delete;
+    cached_poller_t &operator=(const cached_poller_t &) = delete;
 
-    // Get pointer to a specific message part
-    const message_t *peek(size_t index) const { return &m_parts[index]; }
+    template<
+      typename Dummy = void,
+      typename =
+        typename std::enable_if<!std::is_same<T, no_user_data>::value, Dummy>::type>
+    void add(zmq::socket_ref socket, event_flags events, T *user_data)
+    {
+        add_impl(socket, events, user_data);
+    }
 
-    // Get a string copy of a specific message part
-    std::string peekstr(size_t index) const
+    void add(zmq::socket_ref socket, event_flags events)
     {
-        std::string string(m_parts[index].data<char>(), m_parts[index].size());
-        return string;
+        add_impl(socket, events, nullptr);
     }
 
-    // Peek type (fixed-size) from front
-    template<typename T> T peektyp(size_t index) const
+    void remove(zmq::socket_ref socket)
     {
-        static_assert(!std::is_same<T, std::string>::value,
-                      "Use peekstr() instead of peektyp<std::string>()");
-        if (sizeof(T) != m_parts[index].size())
-            throw std::runtime_error(
-              "Invalid type, size does not match the message size");
-        T type = *m_parts[index].data<T>();
-        return type;
+        item &it = find(socket);
+        if (it.dirty)
+            _dirty.erase(std::find(_dirty.begin(), _dirty.end(), &it));
+#if CPPZMQ_HAS_EPOLL
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, it.fd, ZMQ_NULLPTR) == -1)
+            throw error_t();
+#else
+        _fd_poller.remove(it.fd);
+#endif
+        _index.erase(socket.handle());
+        it = item();
+        _free.push_back(&it);
     }
 
-    // Create multipart from type (fixed-size)
-    template<typename T> static multipart_t create(const T &type)
+    void modify(zmq::socket_ref socket, event_flags events)
     {
-        multipart_t multipart;
-        multipart.addtyp(type);
-        return multipart;
+        item &it = find(socket);
+        it.events = events;
+        mark(it);
     }
 
-    // Copy multipart
-    multipart_t clone() const
+    // Recheck the socket on the next wait, e.g. after using it.
+    void touch(zmq::socket_ref socket) { mark(find(socket)); }
+
+    template<typename Sequence>
+    size_t wait_all(Sequence &poller_events, const std::chrono::milliseconds timeout)
     {
-        multipart_t multipart;
-        for (size_t i = 0; i < size(); i++)
-            multipart.addmem(m_parts[i].data(), m_parts[i].size());
-        return multipart;
+        static_assert(std::is_same<typename Sequence::value_type, event_type>::value,
+                      "Sequence::value_type must be of cached_poller_t::event_type");
+        if (_index.empty() && timeout.count() < 0)
+            throw error_t(EFAULT);
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            // while sockets are to be checked, only collect what has fired
+            long wait_ms = 0;
+            if (_dirty.empty() && timeout.count() < 0)
+                wait_ms = -1;
+            else if (_dirty.empty() && timeout.count() > 0)
+                wait_ms = (std::max)(remaining_ms(deadline), 0L);
+            collect(wait_ms);
+            const size_t count = check(poller_events.data(), poller_events.size());
+            if (count > 0)
+                return count;
+            if (timeout.count() >= 0 && std::chrono::steady_clock::now() >= deadline)
+                return 0;
+        }
     }
 
-    // Dump content to string
-    std::string str() const
+    size_t size() const noexcept { return _index.size(); }
+
+  private:
+    struct item
     {
-        std::stringstream ss;
-        for (size_t i = 0; i < m_parts.size(); i++) {
-            const unsigned char *data = m_parts[i].data<unsigned char>();
-            size_t size = m_parts[i].size();
+        socket_ref socket;
+        fd_t fd{};
+        event_flags events{event_flags::none};
+        T *user_data{nullptr};
+        // in _dirty, i.e. to be checked by the next wait
+        bool dirty{false};
+    };
 
-            // Dump the message as text or binary
-            bool isText = true;
-            for (size_t j = 0; j < size; j++) {
-                if (data[j] < 32 || data[j] > 127) {
-                    isText = false;
-                    break;
-                }
-            }
-            ss << "\n[" << std::dec << std::setw(3) << std::setfill('0') << size
-               << "] ";
-            if (size >= 1000) {
-                ss << "... (too big to print)";
-                continue;
-            }
-            for (size_t j = 0; j < size; j++) {
-                if (isText)
-                    ss << static_cast<char>(data[j]);
-                else
-                    ss << std::hex << std::setw(2) << std::setfill('0')
-                       << static_cast<short>(data[j]);
-            }
+    void add_impl(zmq::socket_ref socket, event_flags events, T *user_data)
+    {
+        if (socket == nullptr)
+            throw error_t(ENOTSOCK);
+        if (_index.count(socket.handle()))
+            throw error_t(EINVAL);
+        const fd_t fd = socket.get(sockopt::fd);
+
+        item *it;
+        if (_free.empty()) {
+            _items.emplace_back();
+            it = &_items.back();
+        } else {
+            it = _free.back();
+            _free.pop_back();
+        }
+        it->socket = socket;
+        it->fd = fd;
+        it->events = events;
+        it->user_data = user_data;
+        try {
+#if CPPZMQ_HAS_EPOLL
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = it;
+            if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+                throw error_t();
+#else
+            _fd_poller.add(fd, event_flags::pollin, it);
+#endif
+            _index.emplace(socket.handle(), it);
+        }
+        catch (...) {
+            *it = item();
+            _free.push_back(it);
+            throw;
         }
-        return ss.str();
+        // the socket may already be ready, without a pending notification
+        mark(*it);
     }
 
-    // Check if equal to other multipart
-    bool equal(const multipart_t *other) const ZMQ_NOTHROW
+    // rounded up, so that waiting does not end just before the deadline
+    static long remaining_ms(std::chrono::steady_clock::time_point deadline)
     {
-        return *this == *other;
+        const auto remaining = deadline - std::chrono::steady_clock::now();
+        return static_cast<long>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+            remaining + std::chrono::milliseconds{1} - std::chrono::nanoseconds{1})
+            .count());
     }
 
-    bool operator==(const multipart_t &other) const ZMQ_NOTHROW
+    item &find(zmq::socket_ref socket)
     {
-        if (size() != other.size())
-            return false;
-        for (size_t i = 0; i < size(); i++)
-            if (at(i) != other.at(i))
-                return false;
-        return true;
+        const auto found = _index.find(socket.handle());
+        if (found == _index.end())
+            throw error_t(EINVAL);
+        return *found->second;
     }
 
-    bool operator!=(const multipart_t &other) const ZMQ_NOTHROW
+    void mark(item &it)
     {
-        return !(*this == other);
+        if (!it.dirty) {
+            _dirty.push_back(&it);
+            it.dirty = true;
+        }
     }
 
-#ifdef ZMQ_CPP11
-
-    // Return single part message_t encoded from this multipart_t.
-    message_t encode() const { return zmq::encode(*this); }
-
-    // Decode encoded message into multiple parts and append to self.
-    void decode_append(const message_t &encoded)
+    // Marks the sockets whose descriptor fired, waiting up to wait_ms.
+    void collect(long wait_ms)
     {
-        zmq::decode(encoded, std::back_inserter(*this));
+#if CPPZMQ_HAS_EPOLL
+        epoll_event fired[256];
+        const int rc = epoll_wait(_epoll_fd, fired, 256, static_cast<int>(wait_ms));
+        if (rc == -1) {
+            // interrupted waits are retried by wait_all
+            if (errno == EINTR)
+                return;
+            throw error_t();
+        }
+        for (int i = 0; i < rc; ++i)
+            mark(*static_cast<item *>(fired[i].data.ptr));
+#else
+        if (_index.empty())
+            return;
+        _fired.resize((std::min)(_index.size(), size_t{256}));
+        const size_t n =
+          _fd_poller.wait_all(_fired, std::chrono::milliseconds{wait_ms});
+        for (size_t i = 0; i < n; ++i)
+            mark(*_fired[i].user_data);
+#endif
     }
 
-    // Return a new multipart_t containing the decoded message_t.
-    static multipart_t decode(const message_t &encoded)
+    // Queries the marked sockets and reports at most capacity ready ones.
+    // Reported sockets stay marked and move to the back of the queue.
+    size_t check(event_type *events, size_t capacity)
     {
-        multipart_t tmp;
-        zmq::decode(encoded, std::back_inserter(tmp));
-        return tmp;
+        size_t count = 0;
+        size_t kept = 0;
+        _reported.clear();
+        for (item *it : _dirty) {
+            if (count == capacity) {
+                _dirty[kept++] = it;
+                continue;
+            }
+            const short ready =
+              static_cast<short>(it->socket.get(sockopt::events))
+              & static_cast<short>(it->events);
+            if (ready == 0) {
+                it->dirty = false;
+                continue;
+            }
+            events[count++] = event_type{it->socket, fd_t{}, it->user_data,
+                                         static_cast<event_flags>(ready)};
+            _reported.push_back(it);
+        }
+        _dirty.resize(kept);
+        _dirty.insert(_dirty.end(), _reported.begin(), _reported.end());
+        return count;
     }
 
+    // stable addresses, reused through _free
+    std::deque<item> _items;
+    std::vector<item *> _free;
+    std::unordered_map<void *, item *> _index;
+    std::vector<item *> _dirty;
+    std::vector<item *> _reported;
+#if CPPZMQ_HAS_EPOLL
+    int _epoll_fd;
+#else
+    poller_t<item> _fd_poller;
+    std::vector<poller_event<item>> _fired;
 #endif
-
-  private:
-    // Disable implicit copying (moving is more efficient)
-    multipart_t(const multipart_t &other) ZMQ_DELETED_FUNCTION;
-    void operator=(const multipart_t &other) ZMQ_DELETED_FUNCTION;
-}; // class multipart_t
-
-inline std::ostream &operator<<(std::ostream &os, const multipart_t &msg)
-{
-    return os << msg.str();
-}
-
-#endif // ZMQ_HAS_RVALUE_REFS
+}; // class cached_poller_t
+#endif //  defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
 
 #if defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
 class active_poller_t
@@ -806,7 +4556,9 @@ class active_poller_t
     size_t wait(std::chrono::milliseconds timeout)
     {
         if (need_rebuild) {
-            poller_events.resize(handlers.size());
+            // the base poller rotates through the ready sockets if there are
+            // more than fit
+            poller_events.resize((std::min)(handlers.size(), size_t{max_events}));
             poller_handlers.clear();
             poller_handlers.reserve(handlers.size());
             for (const auto &handler : handlers) {
@@ -829,6 +4581,9 @@ class active_poller_t
     size_t size() const noexcept { return handlers.size(); }
 
   private:
+    // events dispatched per wait at most
+    static ZMQ_CONSTEXPR_VAR size_t max_events = 256;
+
     bool need_rebuild{false};
 
     poller_t<handler_type> base_poller{};
@@ -840,6 +4595,283 @@ class active_poller_t
 }; // class active_poller_t
 #endif //  defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
 
+#if defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
+/*  A single-threaded event loop combining an active_poller_t registry,
+    a timer_wheel and a queue of tasks posted from other threads.
+
+    Each iteration waits on the registered sockets and file descriptors for
+    at most the time until the next timer is due, dispatches their handlers,
+    runs due timers and finally the posted tasks. post() and stop() may be
+    called from any thread; everything else belongs to the thread calling
+    run() or run_once(). Posted tasks go through a bounded lock-free ring,
+    and an inproc PAIR socket wakes the loop up once per batch of posts.
+    Apart from the handlers themselves an iteration does not allocate once
+    the registry is unchanged.
+*/
+class event_loop
+{
+  public:
+    using handler_type = active_poller_t::handler_type;
+    using task_type = std::function<void()>;
+
+    explicit event_loop(context_t &context, size_t queue_capacity = 1024) :
+        _wake_rx(context, socket_type::pair),
+        _wake_tx(context, socket_type::pair),
+        _tasks(queue_capacity)
+    {
+        static std::atomic<unsigned long> instances{0};
+        const std::string endpoint =
+          "inproc://zmq-event-loop-"
+          + std::to_string(reinterpret_cast<std::uintptr_t>(this)) + "-"
+          + std::to_string(instances.fetch_add(1));
+        _wake_rx.bind(endpoint);
+        _wake_tx.connect(endpoint);
+        _poller.add(_wake_rx, event_flags::pollin,
+                    [this](event_flags) { drain_wakeups(); });
+    }
+
+    event_loop(const event_loop &) = delete;
+    event_loop &operator=(const event_loop &) = delete;
+
+    void add(socket_ref socket, event_flags events, handler_type handler)
+    {
+        _poller.add(socket, events, std::move(handler));
+    }
+
+    void add(fd_t fd, event_flags events, handler_type handler)
+    {
+        _poller.add(fd, events, std::move(handler));
+    }
+
+    void remove(socket_ref socket) { _poller.remove(socket); }
+
+    void remove(fd_t fd) { _poller.remove(fd); }
+
+    void modify(socket_ref socket, event_flags events)
+    {
+        _poller.modify(socket, events);
+    }
+
+    void modify(fd_t fd, event_flags events) { _poller.modify(fd, events); }
+
+    timer_wheel &timers() ZMQ_NOTHROW { return _timers; }
+
+    /*  Queue a task to run on the loop thread. Thread-safe.
+        Returns: false if the queue is full, the task is then left untouched.
+    */
+    bool post(task_type &&task)
+    {
+        if (!task)
+            throw std::invalid_argument("null task in event_loop::post");
+        if (!_tasks.try_push(std::move(task)))
+            return false;
+        wake();
+        return true;
+    }
+
+    /*  Make run() return after the current iteration. Thread-safe.
+    */
+    void stop()
+    {
+        _stop.store(true);
+        wake();
+    }
+
+    /*  Run a single iteration, waiting at most timeout (-1 waits until an
+        event, a timer or a posted task is due).
+        Returns: the number of socket and fd events dispatched.
+    */
+    size_t run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds{
+                      -1})
+    {
+        const auto due = _timers.timeout();
+        if (due && (timeout.count() < 0 || *due < timeout))
+            timeout = *due;
+        const size_t count = _poller.wait(timeout);
+        _timers.execute();
+        run_tasks();
+        return count;
+    }
+
+    /*  Run iterations until stop() is called; a pending stop request is
+        consumed, so the loop may be run again afterwards.
+    */
+    void run()
+    {
+        while (!_stop.exchange(false))
+            run_once();
+    }
+
+    // registered sockets and fds
+    size_t size() const ZMQ_NOTHROW { return _poller.size() - 1; }
+    bool empty() const ZMQ_NOTHROW { return size() == 0; }
+
+  private:
+    void wake()
+    {
+        // one wakeup message per batch, until the loop drains it
+        if (_signalled.exchange(true))
+            return;
+        std::lock_guard<std::mutex> lock(_wake_mutex);
+        message_t msg;
+        (void) _wake_tx.send(msg, send_flags::dontwait);
+    }
+
+    void drain_wakeups()
+    {
+        message_t msg;
+        while (_wake_rx.recv(msg, recv_flags::dontwait)) {
+        }
+        // tasks posted after this point signal again
+        _signalled.store(false);
+    }
+
+    void run_tasks()
+    {
+        // bounded, so tasks posting tasks cannot starve sockets and timers
+        task_type task;
+        for (size_t n = _tasks.capacity(); n > 0 && _tasks.try_pop(task); --n) {
+            try {
+                task();
+            }
+            catch (...) {
+                wake();
+                throw;
+            }
+        }
+    }
+
+    // the poller refers to the sockets, so it is declared after them
+    socket_t _wake_rx;
+    socket_t _wake_tx;
+    std::mutex _wake_mutex;
+    active_poller_t _poller;
+    timer_wheel _timers;
+    detail::mpmc_ring<task_type> _tasks;
+    std::atomic<bool> _signalled{false};
+    std::atomic<bool> _stop{false};
+}; // class event_loop
+#endif //  defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
+
+#if defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
+/*  A thread-per-core executor: one worker thread pinned to each selected
+    CPU, each running its own event_loop and owning its own sockets.
+
+    Work is posted to a specific worker, and sockets can be handed over to
+    a worker, which then owns them until the executor is destroyed. The
+    handover goes through the worker's task queue, whose release/acquire
+    ordering provides the full memory barrier libzmq requires when a
+    socket migrates between threads. Handlers and tasks run on the worker
+    thread and must not throw.
+
+        zmq::core_executor executor(ctx); // all CPUs available to the process
+        executor.adopt(0, std::move(socket),
+                       [](zmq::event_loop &loop, zmq::socket_t &s) {
+                           loop.add(s, zmq::event_flags::pollin, ...);
+                       });
+*/
+class core_executor
+{
+  public:
+    using task_type = event_loop::task_type;
+    using setup_type = std::function<void(event_loop &, socket_t &)>;
+
+    explicit core_executor(context_t &context,
+                           std::vector<int> cpus = std::vector<int>{},
+                           size_t queue_capacity = 1024)
+    {
+        if (cpus.empty())
+            cpus = detail::available_cpus();
+        _workers.reserve(cpus.size());
+        try {
+            for (const int cpu : cpus) {
+                std::unique_ptr<worker_state> w(
+                  new worker_state(context, cpu, queue_capacity));
+                event_loop *loop = &w->loop;
+                w->thread = std::thread([loop] { loop->run(); });
+                _workers.push_back(std::move(w));
+                detail::pin_thread(_workers.back()->thread, cpu);
+            }
+        }
+        catch (...) {
+            shutdown();
+            throw;
+        }
+    }
+
+    core_executor(const core_executor &) = delete;
+    core_executor &operator=(const core_executor &) = delete;
+
+    ~core_executor() { shutdown(); }
+
+    size_t size() const ZMQ_NOTHROW { return _workers.size(); }
+
+    int cpu(size_t worker) const { return _workers.at(worker)->cpu; }
+
+    /*  The event loop of a worker. Apart from post() and stop() it may only
+        be used from tasks and handlers running on that worker.
+    */
+    event_loop &loop(size_t worker) { return _workers.at(worker)->loop; }
+
+    /*  Queue a task on a worker. Thread-safe.
+        Returns: false if the worker's queue is full.
+    */
+    bool post(size_t worker, task_type &&task)
+    {
+        return _workers.at(worker)->loop.post(std::move(task));
+    }
+
+    /*  Hand a socket over to a worker, which runs setup with its event loop
+        and the socket once it has taken ownership. The caller must not use
+        the socket (or any socket_ref to it) afterwards.
+        Returns: false if the worker's queue is full, socket is then left
+        with the caller.
+    */
+    bool adopt(size_t worker, socket_t &&socket, setup_type setup)
+    {
+        if (!setup)
+            throw std::invalid_argument("null setup in core_executor::adopt");
+        worker_state *const w = _workers.at(worker).get();
+        // std::function needs a copyable target, socket_t is move-only
+        auto owned = std::make_shared<socket_t>(std::move(socket));
+        const bool posted = w->loop.post([w, owned, setup] {
+            w->sockets.push_back(std::move(*owned));
+            setup(w->loop, w->sockets.back());
+        });
+        if (!posted)
+            socket = std::move(*owned);
+        return posted;
+    }
+
+  private:
+    struct worker_state
+    {
+        worker_state(context_t &context, int cpu_, size_t queue_capacity) :
+            cpu(cpu_), loop(context, queue_capacity)
+        {
+        }
+
+        int cpu;
+        // adopted sockets outlive the loop referring to them
+        std::deque<socket_t> sockets;
+        event_loop loop;
+        std::thread thread;
+    };
+
+    void shutdown() ZMQ_NOTHROW
+    {
+        for (auto &w : _workers)
+            w->loop.stop();
+        for (auto &w : _workers)
+            if (w->thread.joinable())
+                w->thread.join();
+        _workers.clear();
+    }
+
+    std::vector<std::unique_ptr<worker_state>> _workers;
+}; // class core_executor
+#endif //  defined(ZMQ_BUILD_DRAFT_API) && defined(ZMQ_CPP11) && defined(ZMQ_HAVE_POLLER)
+
 
 } // namespace zmq
 